@@ -0,0 +1,247 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <cstddef>
+#include "shide/sh_year_month_day.h"
+
+// Batch conversions between contiguous day counts as stored in `jdate` vectors (doubles with NaN
+// for missing, or integers with NA_INTEGER) and Jalali fields. The loops are branch free so that
+// the compiler is able to vectorize the range checks and the month/day split; missing, invalid
+// and out of range elements get `fill`.
+
+namespace detail
+{
+    // exclusive bounds on day counts that truncate to a supported date
+    constexpr double LOWER_DAYS_BOUND{ static_cast<double>(YEAR_START.jd0[0] - internal::JD_UNIX_EPOCH) };
+    constexpr double UPPER_DAYS_BOUND{
+        static_cast<double>(YEAR_START.jd0[year_start_table::size - 1] + 1 - internal::JD_UNIX_EPOCH) };
+
+    constexpr
+    inline
+    bool
+    days_ok(const double x)
+    {
+        return x > LOWER_DAYS_BOUND && x < UPPER_DAYS_BOUND;
+    }
+
+    // NA_INTEGER is far below the lower bound
+    constexpr
+    inline
+    bool
+    days_ok(const int x)
+    {
+        return x > LOWER_DAYS_BOUND && x < UPPER_DAYS_BOUND;
+    }
+
+    constexpr
+    inline
+    int
+    days_to_jd(const double x, const bool ok)
+    {
+        return static_cast<int>(ok ? x : LOWER_DAYS_BOUND + 1) + internal::JD_UNIX_EPOCH;
+    }
+
+    constexpr
+    inline
+    int
+    days_to_jd(const int x, const bool ok)
+    {
+        return (ok ? x : static_cast<int>(LOWER_DAYS_BOUND) + 1) + internal::JD_UNIX_EPOCH;
+    }
+
+    template <class T, class F>
+    inline
+    void
+    transform_days(const T* x, const std::size_t size, int* out, const int fill, F f)
+    {
+        for (std::size_t i = 0; i < size; ++i)
+        {
+            const bool ok{ days_ok(x[i]) };
+            const int value{ f(days_to_jd(x[i], ok)) };
+            out[i] = ok ? value : fill;
+        }
+    }
+}
+
+// Converts julian days to Jalali fields while remembering the month of the previous call, so that
+// repeated and consecutive days of sorted input are resolved without a table lookup
+class sh_ymd_cursor
+{
+    int first_jd_{ 0 };
+    int last_jd_{ -1 };
+    detail::ymd_parts p_{};
+
+public:
+    // jd must satisfy detail::jd_in_range()
+    detail::ymd_parts operator()(const int jd)
+    {
+        if (jd < first_jd_ || jd > last_jd_)
+        {
+            if (jd == last_jd_ + 1)
+                next_month();
+            else
+                seek(jd);
+        }
+
+        p_.d = jd - first_jd_ + 1;
+        return p_;
+    }
+
+    int first_jd() const { return first_jd_; }
+    int last_jd() const { return last_jd_; }
+
+private:
+    void seek(const int jd)
+    {
+        p_ = detail::split_jd(jd);
+        first_jd_ = jd - p_.d + 1;
+        last_jd_ = first_jd_ + detail::days_in_month(p_.y, p_.m) - 1;
+    }
+
+    void next_month()
+    {
+        first_jd_ = last_jd_ + 1;
+        if (++p_.m > 12)
+        {
+            p_.m = 1;
+            ++p_.y;
+        }
+        last_jd_ = first_jd_ + detail::days_in_month(p_.y, p_.m) - 1;
+    }
+};
+
+namespace detail
+{
+    constexpr std::size_t BLOCK_SIZE{ 128 };
+
+    // true if all `size` elements are valid and fall in one month, which the cursor is then set to
+    template <class T>
+    inline
+    bool
+    block_in_month(const T* x, const std::size_t size, sh_ymd_cursor& cursor)
+    {
+        bool ok{ true };
+        T lo{ x[0] };
+        T hi{ x[0] };
+        for (std::size_t i = 0; i < size; ++i)
+        {
+            ok &= days_ok(x[i]);
+            lo = x[i] < lo ? x[i] : lo;
+            hi = x[i] > hi ? x[i] : hi;
+        }
+
+        if (!ok)
+            return false;
+
+        cursor(days_to_jd(lo, true));
+        return days_to_jd(hi, true) <= cursor.last_jd();
+    }
+
+    template <bool WithMask, class T>
+    inline
+    void
+    ymd_from_days(const T* x, const std::size_t size, int* year, int* month, int* day,
+        unsigned char* valid, const int fill)
+    {
+        sh_ymd_cursor cursor;
+        for (std::size_t b = 0; b < size; b += BLOCK_SIZE)
+        {
+            const std::size_t e{ b + BLOCK_SIZE < size ? b + BLOCK_SIZE : size };
+
+            // sorted or grouped input mostly has whole blocks inside one month, where only the
+            // day has to be computed
+            if (block_in_month(x + b, e - b, cursor))
+            {
+                const auto p = cursor(cursor.first_jd());
+                for (std::size_t i = b; i < e; ++i)
+                {
+                    year[i] = p.y;
+                    month[i] = p.m;
+                    day[i] = days_to_jd(x[i], true) - cursor.first_jd() + 1;
+                    if constexpr (WithMask)
+                        valid[i] = true;
+                }
+                continue;
+            }
+
+            for (std::size_t i = b; i < e; ++i)
+            {
+                const bool ok{ days_ok(x[i]) };
+                const auto p = split_jd(days_to_jd(x[i], ok));
+                year[i] = ok ? p.y : fill;
+                month[i] = ok ? p.m : fill;
+                day[i] = ok ? p.d : fill;
+                if constexpr (WithMask)
+                    valid[i] = ok;
+            }
+        }
+    }
+}
+
+template <class T>
+inline
+void
+sh_ymd_from_days(const T* x, const std::size_t size, int* year, int* month, int* day,
+    unsigned char* valid, const int fill = 0)
+{
+    detail::ymd_from_days<true>(x, size, year, month, day, valid, fill);
+}
+
+template <class T>
+inline
+void
+sh_ymd_from_days(const T* x, const std::size_t size, int* year, int* month, int* day,
+    const int fill = 0)
+{
+    detail::ymd_from_days<false>(x, size, year, month, day, nullptr, fill);
+}
+
+template <class T>
+inline
+void
+sh_yday_from_days(const T* x, const std::size_t size, int* out, const int fill = 0)
+{
+    detail::transform_days(x, size, out, fill, [](const int jd) {
+        return jd - detail::YEAR_START.jd0[detail::year_index(jd)];
+    });
+}
+
+template <class T>
+inline
+void
+sh_qday_from_days(const T* x, const std::size_t size, int* out, const int fill = 0)
+{
+    detail::transform_days(x, size, out, fill, [](const int jd) {
+        const auto p = detail::split_jd(jd);
+        return static_cast<int>(sh_qday(sh_year_month_day{
+            date::year(p.y), date::month(p.m), date::day(p.d) }).count());
+    });
+}
+
+template <class T>
+inline
+void
+sh_wday_from_days(const T* x, const std::size_t size, int* out, const int fill = 0)
+{
+    // 1970-01-01 was a Thursday, the sixth day of the Jalali week
+    detail::transform_days(x, size, out, fill, [](const int jd) {
+        return detail::mod(jd - internal::JD_UNIX_EPOCH + 5, 7) + 1;
+    });
+}
+
+inline
+void
+sh_days_from_ymd(const int* year, const int* month, const int* day, const std::size_t size,
+    double* out, const double fill)
+{
+    using namespace detail;
+    for (std::size_t i = 0; i < size; ++i)
+    {
+        // NA_INTEGER is out of range for every field, so it needs no separate test
+        const bool ok{ ymd_ok(year[i], month[i], day[i]) };
+        const int jd{ ok ? ymd_to_jd(year[i], month[i], day[i]) : internal::JD_UNIX_EPOCH };
+        out[i] = ok ? static_cast<double>(jd - internal::JD_UNIX_EPOCH) : fill;
+    }
+}
+
+#endif
@@ -0,0 +1,65 @@
+#ifndef BUCKET_H
+#define BUCKET_H
+
+#include <unordered_map>
+#include <vector>
+
+// Numbers the distinct period starts of a vector in order of first appearance and counts their
+// elements. An element in the same period as the previous one takes its id, and while the
+// starts don't decrease, a start greater than the last one is new, so sorted input is numbered
+// without hashing. The first decrease builds a hash table of the starts seen so far, which is
+// used from then on.
+class bucket_index
+{
+    std::vector<double> starts_;
+    std::vector<int> counts_;
+    std::unordered_map<double, int> ids_;
+    int last_{ -1 };
+    bool sorted_{ true };
+
+    int add(const double start)
+    {
+        starts_.push_back(start);
+        counts_.push_back(0);
+        return static_cast<int>(starts_.size() - 1);
+    }
+
+    int find_or_add(const double start)
+    {
+        if (sorted_ && (starts_.empty() || start > starts_.back()))
+            return add(start);
+
+        if (sorted_)
+        {
+            sorted_ = false;
+            ids_.reserve(2 * starts_.size());
+            for (std::size_t i = 0; i < starts_.size(); ++i)
+                ids_.emplace(starts_[i], static_cast<int>(i));
+        }
+
+        const auto it = ids_.find(start);
+        if (it != ids_.end())
+            return it->second;
+
+        const int id{ add(start) };
+        ids_.emplace(start, id);
+        return id;
+    }
+
+public:
+    // the 0-based id of the period starting at `start`
+    int operator()(const double start)
+    {
+        if (last_ < 0 || starts_[last_] != start)
+            last_ = find_or_add(start);
+
+        ++counts_[last_];
+        return last_;
+    }
+
+    const std::vector<double>& starts() const { return starts_; }
+
+    const std::vector<int>& counts() const { return counts_; }
+};
+
+#endif
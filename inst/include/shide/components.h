@@ -0,0 +1,86 @@
+#ifndef COMPONENTS_H
+#define COMPONENTS_H
+
+#include <optional>
+#include <array>
+#include <string>
+#include <string_view>
+#include "shide/sh_year_month_day.h"
+
+enum class Component
+{
+    year, quarter, month, day, yday, qday, wday, week, days_in_month, leap_year,
+    hour, minute, second
+};
+
+constexpr
+std::optional<Component>
+string_to_component(const std::string& component_name)
+{
+    constexpr std::array<std::pair<std::string_view, Component>, 13> component_pair{ {
+        {"year", Component::year},
+        {"quarter", Component::quarter},
+        {"month", Component::month},
+        {"day", Component::day},
+        {"yday", Component::yday},
+        {"qday", Component::qday},
+        {"wday", Component::wday},
+        {"week", Component::week},
+        {"days_in_month", Component::days_in_month},
+        {"leap_year", Component::leap_year},
+        {"hour", Component::hour},
+        {"minute", Component::minute},
+        {"second", Component::second}
+    } };
+
+    for (const auto& pair : component_pair) {
+        if (pair.first == component_name) {
+            return pair.second;
+        }
+    }
+
+    return {};
+}
+
+// `p` is the result of detail::split_jd(jd) and `tod` is the number of seconds since midnight
+constexpr
+int
+component_value(const Component component, const detail::ymd_parts& p, const int jd, const int tod)
+{
+    using namespace internal;
+    constexpr int quarter_data[12] = { 0, 31, 62, 0, 31, 62, 0, 30, 60, 0, 30, 60 };
+
+    switch (component)
+    {
+    case Component::year:
+        return p.y;
+    case Component::quarter:
+        return (p.m - 1) / 3 + 1;
+    case Component::month:
+        return p.m;
+    case Component::day:
+        return p.d;
+    case Component::yday:
+        return MONTH_DATA_CUM[p.m - 1] + p.d;
+    case Component::qday:
+        return quarter_data[p.m - 1] + p.d;
+    case Component::wday:
+        return detail::mod(jd - JD_UNIX_EPOCH + 5, 7) + 1;
+    case Component::week:
+        return (MONTH_DATA_CUM[p.m - 1] + p.d - 1) / 7 + 1;
+    case Component::days_in_month:
+        return detail::days_in_month(p.y, p.m);
+    case Component::leap_year:
+        return detail::is_leap(p.y);
+    case Component::hour:
+        return tod / 3600;
+    case Component::minute:
+        return tod / 60 % 60;
+    case Component::second:
+        return tod % 60;
+    }
+
+    return 0;
+}
+
+#endif
@@ -0,0 +1,580 @@
+#ifndef FORMAT_H
+#define FORMAT_H
+
+#include <array>
+#include <chrono>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "shide/sh_year_month_day.h"
+
+// A format string compiled into a sequence of operations that write Jalali fields straight into a
+// reusable buffer. Names of months and weekdays and the digits of numeric fields come from
+// constant UTF-8 tables of the chosen format_locale. Directives that have no operation of their
+// own, like %U or %G, are written one at a time by date::to_stream(), so that the rest of the
+// format still follows the locale.
+
+enum class FormatOp
+{
+    literal, year, year2, month, day, day_space, yday, wday, wday_iso, month_name, month_abbrev,
+    wday_name, wday_abbrev, hour, hour12, minute, second, am_pm, offset, offset_colon, zone,
+    stream
+};
+
+enum class Names { en, fa };
+
+enum class Digits { latin, persian, arabic };
+
+struct format_locale
+{
+    Names names{ Names::en };
+    Digits digits{ Digits::latin };
+};
+
+inline
+std::optional<Names>
+string_to_names(const std::string& names)
+{
+    if (names == "en")
+        return Names::en;
+    if (names == "fa")
+        return Names::fa;
+
+    return {};
+}
+
+inline
+std::optional<Digits>
+string_to_digits(const std::string& digits)
+{
+    if (digits == "latin")
+        return Digits::latin;
+    if (digits == "persian")
+        return Digits::persian;
+    if (digits == "arabic")
+        return Digits::arabic;
+
+    return {};
+}
+
+struct format_token
+{
+    FormatOp op;
+    // position and length of the text of a literal or of a streamed directive in
+    // format_program::literals_
+    std::size_t begin;
+    std::size_t size;
+};
+
+// the fields of a single date-time; `tod` is the number of seconds since midnight
+struct format_fields
+{
+    detail::ymd_parts ymd;
+    int tod;
+    std::chrono::seconds offset;
+};
+
+namespace detail
+{
+    using name_table = std::array<std::string_view, 12>;
+    using wday_table = std::array<std::string_view, 7>;
+
+    constexpr name_table MONTH_NAMES_EN{
+        "Farvardin", "Ordibehesht", "Khordad", "Tir", "Mordad", "Shahrivar",
+        "Mehr", "Aban", "Azar", "Dey", "Bahman", "Esfand"
+    };
+
+    constexpr name_table MONTH_ABBREVS_EN{
+        "Far", "Ord", "Kho", "Tir", "Mor", "Sha", "Meh", "Aba", "Aza", "Dey", "Bah", "Esf"
+    };
+
+    // Persian names have no customary abbreviations
+    constexpr name_table MONTH_NAMES_FA{
+        "\u0641\u0631\u0648\u0631\u062F\u06CC\u0646",
+        "\u0627\u0631\u062F\u06CC\u0628\u0647\u0634\u062A",
+        "\u062E\u0631\u062F\u0627\u062F",
+        "\u062A\u06CC\u0631",
+        "\u0645\u0631\u062F\u0627\u062F",
+        "\u0634\u0647\u0631\u06CC\u0648\u0631",
+        "\u0645\u0647\u0631",
+        "\u0622\u0628\u0627\u0646",
+        "\u0622\u0630\u0631",
+        "\u062F\u06CC",
+        "\u0628\u0647\u0645\u0646",
+        "\u0627\u0633\u0641\u0646\u062F"
+    };
+
+    // weeks start on Saturday
+    constexpr wday_table WDAY_NAMES_EN{
+        "Saturday", "Sunday", "Monday", "Tuesday", "Wednesday", "Thursday", "Friday"
+    };
+
+    constexpr wday_table WDAY_ABBREVS_EN{ "Sat", "Sun", "Mon", "Tue", "Wed", "Thu", "Fri" };
+
+    constexpr wday_table WDAY_NAMES_FA{
+        "\u0634\u0646\u0628\u0647",
+        "\u06CC\u06A9\u0634\u0646\u0628\u0647",
+        "\u062F\u0648\u0634\u0646\u0628\u0647",
+        "\u0633\u0647\u200C\u0634\u0646\u0628\u0647",
+        "\u0686\u0647\u0627\u0631\u0634\u0646\u0628\u0647",
+        "\u067E\u0646\u062C\u0634\u0646\u0628\u0647",
+        "\u062C\u0645\u0639\u0647"
+    };
+
+    constexpr wday_table WDAY_ABBREVS_FA{
+        "\u0634", "\u06CC", "\u062F", "\u0633", "\u0686", "\u067E", "\u062C"
+    };
+
+    constexpr std::array<std::string_view, 2> AM_PM_EN{ "AM", "PM" };
+
+    constexpr std::array<std::string_view, 2> AM_PM_FA{ "\u0642.\u0638", "\u0628.\u0638" };
+
+    // lead bytes of the two byte UTF-8 encodings of U+06F0 (EXTENDED ARABIC-INDIC DIGIT ZERO)
+    // and U+0660 (ARABIC-INDIC DIGIT ZERO); the nine digits after zero follow consecutively in
+    // the second byte
+    constexpr unsigned char PERSIAN_DIGIT[2]{ 0xDB, 0xB0 };
+    constexpr unsigned char ARABIC_DIGIT[2]{ 0xD9, 0xA0 };
+
+    struct two_digit_table
+    {
+        char digits[200];
+
+        constexpr two_digit_table() : digits{}
+        {
+            for (int i = 0; i < 100; ++i)
+            {
+                digits[2 * i] = static_cast<char>('0' + i / 10);
+                digits[2 * i + 1] = static_cast<char>('0' + i % 10);
+            }
+        }
+    };
+
+    inline constexpr two_digit_table TWO_DIGITS{};
+
+    // `x` must be in [0, 99]
+    inline
+    void
+    put2(std::string& buf, const int x)
+    {
+        buf.append(TWO_DIGITS.digits + 2 * x, 2);
+    }
+
+    // as date::year is written: at least four digits with a leading minus sign if negative;
+    // supported Jalali years have at most four digits
+    inline
+    void
+    put_year(std::string& buf, int y)
+    {
+        if (y < 0)
+        {
+            buf.push_back('-');
+            y = -y;
+        }
+
+        put2(buf, y / 100);
+        put2(buf, y % 100);
+    }
+
+    // replaces the ASCII digits that `buf` has from `first` on with the digits of `digits`
+    inline
+    void
+    localize_digits(std::string& buf, const std::size_t first, const Digits digits)
+    {
+        if (digits == Digits::latin)
+            return;
+
+        const unsigned char* zero{ digits == Digits::persian ? PERSIAN_DIGIT : ARABIC_DIGIT };
+        std::size_t n{ 0 };
+        for (std::size_t i = first; i < buf.size(); ++i)
+            n += buf[i] >= '0' && buf[i] <= '9';
+
+        // widen from the back so that every byte is read before it is overwritten
+        std::size_t src{ buf.size() };
+        buf.resize(buf.size() + n);
+        std::size_t dst{ buf.size() };
+        while (src > first)
+        {
+            const char c{ buf[--src] };
+            if (c >= '0' && c <= '9')
+            {
+                buf[--dst] = static_cast<char>(zero[1] + (c - '0'));
+                buf[--dst] = static_cast<char>(zero[0]);
+            }
+            else
+            {
+                buf[--dst] = c;
+            }
+        }
+    }
+}
+
+class format_program
+{
+    std::vector<format_token> tokens_;
+    std::string literals_;
+    format_locale locale_;
+    bool has_tod_{ false };
+
+    void push(const FormatOp op)
+    {
+        tokens_.push_back(format_token{ op, 0, 0 });
+    }
+
+    void push_literal(const std::string_view text)
+    {
+        if (!tokens_.empty() && tokens_.back().op == FormatOp::literal &&
+            tokens_.back().begin + tokens_.back().size == literals_.size())
+        {
+            tokens_.back().size += text.size();
+        }
+        else
+        {
+            tokens_.push_back(format_token{ FormatOp::literal, literals_.size(), text.size() });
+        }
+
+        literals_.append(text);
+    }
+
+    // a directive for date::to_stream(), kept null-terminated in `literals_`
+    void push_stream(const std::string_view directive)
+    {
+        tokens_.push_back(format_token{ FormatOp::stream, literals_.size(), directive.size() });
+        literals_.append(directive);
+        literals_.push_back('\0');
+    }
+
+    void push_time()
+    {
+        push(FormatOp::hour);
+        push_literal(":");
+        push(FormatOp::minute);
+        push_literal(":");
+        push(FormatOp::second);
+    }
+
+public:
+    const format_locale& locale() const { return locale_; }
+
+    // `has_tod` tells whether the formatted values have a time of day and a time zone
+    static
+    format_program
+    compile(const std::string_view fmt, const bool has_tod, const format_locale& locale = {})
+    {
+        format_program program;
+        program.locale_ = locale;
+        program.has_tod_ = has_tod;
+
+        for (std::size_t i = 0; i < fmt.size(); ++i)
+        {
+            if (fmt[i] != '%')
+            {
+                program.push_literal(fmt.substr(i, 1));
+                continue;
+            }
+
+            const std::size_t start{ i };
+            if (++i == fmt.size())
+            {
+                program.push_stream(fmt.substr(start));
+                break;
+            }
+
+            bool modified{ false };
+            if (fmt[i] == 'E' || fmt[i] == 'O')
+            {
+                if (++i == fmt.size())
+                {
+                    program.push_stream(fmt.substr(start));
+                    break;
+                }
+
+                if (fmt[i] != 'z')
+                {
+                    program.push_stream(fmt.substr(start, i + 1 - start));
+                    continue;
+                }
+
+                modified = true;
+            }
+
+            switch (fmt[i])
+            {
+            case '%':
+                program.push_literal("%");
+                break;
+            case 'n':
+                program.push_literal("\n");
+                break;
+            case 't':
+                program.push_literal("\t");
+                break;
+            case 'Y':
+                program.push(FormatOp::year);
+                break;
+            case 'y':
+                program.push(FormatOp::year2);
+                break;
+            case 'm':
+                program.push(FormatOp::month);
+                break;
+            case 'd':
+                program.push(FormatOp::day);
+                break;
+            case 'e':
+                program.push(FormatOp::day_space);
+                break;
+            case 'j':
+                program.push(FormatOp::yday);
+                break;
+            case 'w':
+                program.push(FormatOp::wday);
+                break;
+            case 'u':
+                program.push(FormatOp::wday_iso);
+                break;
+            case 'B':
+                program.push(FormatOp::month_name);
+                break;
+            case 'b':
+            case 'h':
+                program.push(FormatOp::month_abbrev);
+                break;
+            case 'A':
+                program.push(FormatOp::wday_name);
+                break;
+            case 'a':
+                program.push(FormatOp::wday_abbrev);
+                break;
+            case 'F':
+                program.push(FormatOp::year);
+                program.push_literal("-");
+                program.push(FormatOp::month);
+                program.push_literal("-");
+                program.push(FormatOp::day);
+                break;
+            case 'D':
+            case 'x':
+                program.push(FormatOp::month);
+                program.push_literal("/");
+                program.push(FormatOp::day);
+                program.push_literal("/");
+                program.push(FormatOp::year2);
+                break;
+            default:
+                if (!has_tod)
+                {
+                    program.push_stream(fmt.substr(start, i + 1 - start));
+                    break;
+                }
+
+                switch (fmt[i])
+                {
+                case 'H':
+                    program.push(FormatOp::hour);
+                    break;
+                case 'I':
+                    program.push(FormatOp::hour12);
+                    break;
+                case 'M':
+                    program.push(FormatOp::minute);
+                    break;
+                case 'S':
+                    program.push(FormatOp::second);
+                    break;
+                case 'p':
+                    program.push(FormatOp::am_pm);
+                    break;
+                case 'R':
+                    program.push(FormatOp::hour);
+                    program.push_literal(":");
+                    program.push(FormatOp::minute);
+                    break;
+                case 'T':
+                case 'X':
+                    program.push_time();
+                    break;
+                case 'r':
+                    program.push(FormatOp::hour12);
+                    program.push_literal(":");
+                    program.push(FormatOp::minute);
+                    program.push_literal(":");
+                    program.push(FormatOp::second);
+                    program.push_literal(" ");
+                    program.push(FormatOp::am_pm);
+                    break;
+                case 'c':
+                    program.push(FormatOp::wday_abbrev);
+                    program.push_literal(" ");
+                    program.push(FormatOp::month_abbrev);
+                    program.push_literal(" ");
+                    program.push(FormatOp::day_space);
+                    program.push_literal(" ");
+                    program.push_time();
+                    program.push_literal(" ");
+                    program.push(FormatOp::year);
+                    break;
+                case 'z':
+                    program.push(modified ? FormatOp::offset_colon : FormatOp::offset);
+                    break;
+                case 'Z':
+                    program.push(FormatOp::zone);
+                    break;
+                default:
+                    program.push_stream(fmt.substr(start, i + 1 - start));
+                }
+            }
+        }
+
+        return program;
+    }
+
+    // appends `fds` formatted to `buf`, writing `zone` for %Z and streamed directives through
+    // `os`; returns false if date::to_stream() fails on a directive, as it does on the time
+    // directives of values without a time of day
+    bool
+    write(std::string& buf, const format_fields& fds, std::ostringstream& os,
+          const std::string& zone = {}) const
+    {
+        using detail::put2;
+
+        const bool fa{ locale_.names == Names::fa };
+        const int h{ fds.tod / 3600 };
+
+        for (const auto& token : tokens_)
+        {
+            const std::size_t first{ buf.size() };
+
+            switch (token.op)
+            {
+            case FormatOp::literal:
+                buf.append(literals_, token.begin, token.size);
+                continue;
+            case FormatOp::month_name:
+                buf.append((fa ? detail::MONTH_NAMES_FA : detail::MONTH_NAMES_EN)[fds.ymd.m - 1]);
+                continue;
+            case FormatOp::month_abbrev:
+                buf.append((fa ? detail::MONTH_NAMES_FA : detail::MONTH_ABBREVS_EN)[fds.ymd.m - 1]);
+                continue;
+            case FormatOp::wday_name:
+                buf.append((fa ? detail::WDAY_NAMES_FA : detail::WDAY_NAMES_EN)[wday0(fds)]);
+                continue;
+            case FormatOp::wday_abbrev:
+                buf.append((fa ? detail::WDAY_ABBREVS_FA : detail::WDAY_ABBREVS_EN)[wday0(fds)]);
+                continue;
+            case FormatOp::am_pm:
+                buf.append((fa ? detail::AM_PM_FA : detail::AM_PM_EN)[h < 12 ? 0 : 1]);
+                continue;
+            case FormatOp::zone:
+                buf.append(zone);
+                continue;
+            case FormatOp::year:
+                detail::put_year(buf, fds.ymd.y);
+                break;
+            case FormatOp::year2:
+                put2(buf, (fds.ymd.y < 0 ? -fds.ymd.y : fds.ymd.y) % 100);
+                break;
+            case FormatOp::month:
+                put2(buf, fds.ymd.m);
+                break;
+            case FormatOp::day:
+                put2(buf, fds.ymd.d);
+                break;
+            case FormatOp::day_space:
+                buf.push_back(fds.ymd.d < 10 ? ' ' : static_cast<char>('0' + fds.ymd.d / 10));
+                buf.push_back(static_cast<char>('0' + fds.ymd.d % 10));
+                break;
+            case FormatOp::yday:
+            {
+                const int yday{ internal::MONTH_DATA_CUM[fds.ymd.m - 1] + fds.ymd.d };
+                buf.push_back(static_cast<char>('0' + yday / 100));
+                put2(buf, yday % 100);
+                break;
+            }
+            case FormatOp::wday:
+            case FormatOp::wday_iso:
+            {
+                // days since Sunday
+                const int w{ (wday0(fds) + 6) % 7 };
+                buf.push_back(static_cast<char>(
+                    '0' + (token.op == FormatOp::wday_iso && w == 0 ? 7 : w)));
+                break;
+            }
+            case FormatOp::hour:
+                put2(buf, h);
+                break;
+            case FormatOp::hour12:
+                put2(buf, h % 12 == 0 ? 12 : h % 12);
+                break;
+            case FormatOp::minute:
+                put2(buf, fds.tod / 60 % 60);
+                break;
+            case FormatOp::second:
+                put2(buf, fds.tod % 60);
+                break;
+            case FormatOp::offset:
+            case FormatOp::offset_colon:
+            {
+                const auto m = std::chrono::duration_cast<std::chrono::minutes>(fds.offset).count();
+                const int abs_m{ static_cast<int>(m < 0 ? -m : m) };
+                buf.push_back(m < 0 ? '-' : '+');
+                put2(buf, abs_m / 60 % 100);
+                if (token.op == FormatOp::offset_colon)
+                    buf.push_back(':');
+                put2(buf, abs_m % 60);
+                break;
+            }
+            case FormatOp::stream:
+                if (!stream(buf, literals_.data() + token.begin, fds, os, zone))
+                    return false;
+                break;
+            }
+
+            // only numeric fields and streamed directives get here
+            detail::localize_digits(buf, first, locale_.digits);
+        }
+
+        return true;
+    }
+
+private:
+    // appends `directive` written by date::to_stream() for the fields of `fds`, which are
+    // labelled as a Gregorian date
+    bool
+    stream(std::string& buf, const char* directive, const format_fields& fds,
+           std::ostringstream& os, const std::string& zone) const
+    {
+        os.str(std::string());
+        os.clear();
+
+        const date::year_month_day ymd{
+            date::year(fds.ymd.y), date::month(fds.ymd.m), date::day(fds.ymd.d) };
+
+        if (has_tod_)
+        {
+            const date::fields<std::chrono::seconds> dt{
+                ymd, date::hh_mm_ss<std::chrono::seconds>{ std::chrono::seconds{ fds.tod } } };
+            date::to_stream(os, directive, dt, &zone, &fds.offset);
+        }
+        else
+        {
+            date::to_stream(os, directive, ymd);
+        }
+
+        if (os.fail())
+            return false;
+
+        buf.append(os.str());
+        return true;
+    }
+
+    // days since Saturday, the first day of the Jalali week
+    static int wday0(const format_fields& fds)
+    {
+        const int jd{ detail::ymd_to_jd(fds.ymd.y, fds.ymd.m, fds.ymd.d) };
+        return detail::mod(jd - internal::JD_UNIX_EPOCH + 5, 7);
+    }
+};
+
+#endif
@@ -36,13 +36,11 @@ string_to_choose(const std::string& choose_str)
 
 inline
 choose
-sys_seconds_to_choose(const sys_seconds& tp, const date::time_zone* tz)
+sys_seconds_to_choose(const sys_seconds& tp, const zone_table& table)
 {
-    date::sys_info info;
-    tzdb::get_sys_info(tp, tz, info);
+    const auto info = table.sys_interval(tp);
     const date::local_seconds ls_ref{ (tp + info.offset).time_since_epoch() };
-    date::local_info info2;
-    tzdb::get_local_info(ls_ref, tz, info2);
+    const auto info2 = table.local_info(ls_ref);
 
     if (info2.first.begin == info.begin)
     {
@@ -60,10 +58,10 @@ sys_seconds_to_choose(const sys_seconds& tp, const date::time_zone* tz)
 
 inline
 double
-jdatetime_from_local_seconds(const date::local_seconds& ls, const date::time_zone* tz,
-    date::local_info& info, choose c, const sys_seconds* ss_ref = nullptr)
+jdatetime_from_local_seconds(const date::local_seconds& ls, local_info_cursor& cursor, choose c,
+    const sys_seconds* ss_ref = nullptr)
 {
-    tzdb::get_local_info(ls, tz, info);
+    const zone_local_info& info{ cursor(ls) };
     seconds s{};
     if (info.result == date::local_info::unique)
     {
@@ -72,7 +70,7 @@ jdatetime_from_local_seconds(const date::local_seconds& ls, const date::time_zon
     else if (info.result == date::local_info::ambiguous)
     {
         if (ss_ref)
-            c = sys_seconds_to_choose(*ss_ref, tz);
+            c = sys_seconds_to_choose(*ss_ref, cursor.table());
         switch (c)
         {
         case choose::earliest:
@@ -106,16 +104,29 @@ make_local_seconds(const sh_fields& fds)
     return local_days(fds.ymd) + fds.tod.to_duration();
 }
 
+constexpr
+std::optional<date::local_seconds>
+make_local_seconds(const int y, const int m, const int d, const int h, const int mi, const int s)
+{
+    if (!detail::ymd_ok(y, m, d))
+        return {};
+
+    if (h < 0 || h > 23 || mi < 0 || mi > 59 || s < 0 || s > 59)
+        return {};
+
+    const date::local_days ld{ days{ detail::ymd_to_jd(y, m, d) - internal::JD_UNIX_EPOCH } };
+    return ld + hours{ h } + minutes{ mi } + seconds{ s };
+}
+
 inline
 std::optional<double>
-make_jdatetime(const sh_fields& fds, const date::time_zone* tz,
-    date::local_info& info, choose c = choose::earliest)
+make_jdatetime(const sh_fields& fds, local_info_cursor& cursor, choose c = choose::earliest)
 {
     auto ls = make_local_seconds(fds);
     if (!ls.has_value())
         return {};
 
-    const auto dt = jdatetime_from_local_seconds(*ls, tz, info, c);
+    const auto dt = jdatetime_from_local_seconds(*ls, cursor, c);
     if (std::isnan(dt))
         return {};
 
@@ -124,14 +135,13 @@ make_jdatetime(const sh_fields& fds, const date::time_zone* tz,
 
 inline
 std::optional<double>
-make_jdatetime(const sh_fields& fds, const date::time_zone* tz,
-    date::local_info& info, const sys_seconds& ss_ref)
+make_jdatetime(const sh_fields& fds, local_info_cursor& cursor, const sys_seconds& ss_ref)
 {
     auto ls = make_local_seconds(fds);
     if (!ls.has_value())
         return {};
 
-    const auto dt = jdatetime_from_local_seconds(*ls, tz, info, choose{}, &ss_ref);
+    const auto dt = jdatetime_from_local_seconds(*ls, cursor, choose{}, &ss_ref);
     if (std::isnan(dt))
         return {};
 
@@ -143,12 +153,12 @@ std::optional<double>
 make_jdatetime(const sh_fields& fds, const std::string& tz_name,
     choose c=choose::earliest)
 {
-    const date::time_zone* tz{};
-    if (!tzdb::locate_zone(tz_name, tz))
+    const zone_table* table{ locate_zone_table(tz_name) };
+    if (!table)
         return {};
 
-    date::local_info info;
-    return make_jdatetime(fds, tz, info, c);
+    local_info_cursor cursor{ *table };
+    return make_jdatetime(fds, cursor, c);
 }
 
 inline
@@ -156,12 +166,12 @@ std::optional<double>
 make_jdatetime(const sh_fields& fds, const std::string& tz_name,
     const sys_seconds& ss_ref)
 {
-    const date::time_zone* tz{};
-    if (!tzdb::locate_zone(tz_name, tz))
+    const zone_table* table{ locate_zone_table(tz_name) };
+    if (!table)
         return {};
 
-    date::local_info info;
-    return make_jdatetime(fds, tz, info, ss_ref);
+    local_info_cursor cursor{ *table };
+    return make_jdatetime(fds, cursor, ss_ref);
 }
 
 constexpr
@@ -177,11 +187,12 @@ sh_fields
 make_sh_fields(const date::sys_seconds& tp, const std::string& tz_name)
 {
     sh_fields fds{};
-    const date::time_zone* tz{};
-    if (!tzdb::locate_zone(tz_name, tz))
+    const zone_table* table{ locate_zone_table(tz_name) };
+    if (!table)
         return fds;
 
-    return make_sh_fields(to_local_seconds(tp, tz));
+    sys_info_cursor cursor{ *table };
+    return make_sh_fields(to_local_seconds(tp, cursor));
 }
 
 constexpr
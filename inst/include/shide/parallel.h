@@ -0,0 +1,168 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+// smallest number of elements worth handing to a thread of its own
+constexpr std::size_t MIN_CHUNK_SIZE{ 4096 };
+
+// `n_threads`, at least 1 and at most the number of hardware threads when that is known
+inline
+std::size_t
+usable_threads(const int n_threads)
+{
+    const std::size_t n{ n_threads > 1 ? static_cast<std::size_t>(n_threads) : 1 };
+    const std::size_t hardware{ std::thread::hardware_concurrency() };
+    return hardware > 0 && n > hardware ? hardware : n;
+}
+
+// number of chunks that [0, size) is split into by thread_pool::parallel_for() with `n_threads`
+// threads
+inline
+std::size_t
+num_chunks(const std::size_t size, const std::size_t n_threads)
+{
+    const std::size_t n{ size / MIN_CHUNK_SIZE };
+    return n < 1 ? 1 : n < n_threads ? n : n_threads;
+}
+
+// Worker threads that are started once and then run the chunks of every parallel_for() call, so
+// that a kernel working in rounds doesn't start threads for each round. Worker `k` always runs
+// chunk `k`; the calling thread runs chunk 0 and any chunk whose worker couldn't be started.
+class thread_pool
+{
+    std::vector<std::thread> threads_;
+    std::mutex mutex_;
+    std::condition_variable start_;
+    std::condition_variable done_;
+    const std::function<void(std::size_t)>* job_{ nullptr };
+    // incremented for every job, so that a worker can tell a new job from the one it has run
+    std::size_t generation_{ 0 };
+    std::size_t n_chunks_{ 0 };
+    std::size_t pending_{ 0 };
+    bool stop_{ false };
+
+    void work(const std::size_t k)
+    {
+        std::size_t seen{ 0 };
+        std::unique_lock<std::mutex> lock{ mutex_ };
+        for (;;)
+        {
+            start_.wait(lock, [&] { return stop_ || generation_ != seen; });
+            if (stop_)
+                return;
+
+            seen = generation_;
+            if (k >= n_chunks_)
+                continue;
+
+            const auto* job = job_;
+            lock.unlock();
+            (*job)(k);
+            lock.lock();
+
+            if (--pending_ == 0)
+                done_.notify_one();
+        }
+    }
+
+public:
+    // starts `n_threads - 1` workers, fewer if the system refuses to start more
+    explicit thread_pool(const std::size_t n_threads)
+    {
+        for (std::size_t k = 1; k < n_threads; ++k)
+        {
+            try
+            {
+                threads_.emplace_back(&thread_pool::work, this, k);
+            }
+            catch (const std::system_error&)
+            {
+                break;
+            }
+        }
+    }
+
+    thread_pool(const thread_pool&) = delete;
+    thread_pool& operator=(const thread_pool&) = delete;
+
+    ~thread_pool()
+    {
+        {
+            const std::lock_guard<std::mutex> lock{ mutex_ };
+            stop_ = true;
+        }
+
+        start_.notify_all();
+        for (auto& thread : threads_)
+            thread.join();
+    }
+
+    // Splits [0, size) into `n_chunks` contiguous chunks and calls `f(chunk, begin, end)` for
+    // each. As the chunks are fixed by `size` and `n_chunks` only, results don't depend on
+    // scheduling. The first exception thrown by `f` is rethrown once all chunks are done. Unless
+    // `n_chunks` is 1, `f` must not call the R API.
+    template <class F>
+    void
+    parallel_for(const std::size_t size, const std::size_t n_chunks, F f)
+    {
+        const auto bound = [&](const std::size_t k) { return size / n_chunks * k +
+            (k < size % n_chunks ? k : size % n_chunks); };
+
+        if (n_chunks <= 1)
+        {
+            f(std::size_t{ 0 }, std::size_t{ 0 }, size);
+            return;
+        }
+
+        std::vector<std::exception_ptr> errors(n_chunks);
+        const std::function<void(std::size_t)> run = [&](const std::size_t k) {
+            try
+            {
+                f(k, bound(k), bound(k + 1));
+            }
+            catch (...)
+            {
+                errors[k] = std::current_exception();
+            }
+        };
+
+        const std::size_t n_workers{ std::min(n_chunks - 1, threads_.size()) };
+        if (n_workers > 0)
+        {
+            const std::lock_guard<std::mutex> lock{ mutex_ };
+            job_ = &run;
+            n_chunks_ = n_workers + 1;
+            pending_ = n_workers;
+            ++generation_;
+        }
+        start_.notify_all();
+
+        run(0);
+        for (std::size_t k = n_workers + 1; k < n_chunks; ++k)
+            run(k);
+
+        if (n_workers > 0)
+        {
+            std::unique_lock<std::mutex> lock{ mutex_ };
+            done_.wait(lock, [&] { return pending_ == 0; });
+            job_ = nullptr;
+        }
+
+        for (const auto& error : errors)
+        {
+            if (error)
+                std::rethrow_exception(error);
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,252 @@
+#ifndef PARSE_H
+#define PARSE_H
+
+#include <string>
+#include <string_view>
+
+// Parsers for the common layouts of Jalali dates and date-times that scan the characters
+// directly instead of going through an istringstream and date::from_stream(), decoding Persian
+// and Arabic-Indic digits in the same scan. A layout is selected once per call from the format
+// string; the parsers only accept input that is a plain match of the layout and leave anything
+// else (leading or trailing characters, signs, fractional seconds, out of range times) to
+// date::from_stream(), so the two paths never disagree. For the same reason, input for
+// date::from_stream() goes through normalize_digits(), which decodes the digits and the Arabic
+// date separator as the parsers do.
+
+enum class ParseLayout
+{
+    generic, ymd_dash, ymd_slash, ymd_hms_dash, ymd_compact
+};
+
+inline
+ParseLayout
+string_to_parse_layout(const std::string_view fmt)
+{
+    if (fmt == "%Y-%m-%d" || fmt == "%F")
+        return ParseLayout::ymd_dash;
+    if (fmt == "%Y/%m/%d")
+        return ParseLayout::ymd_slash;
+    if (fmt == "%Y-%m-%d %H:%M:%S" || fmt == "%F %T" || fmt == "%Y-%m-%d %T" ||
+        fmt == "%F %H:%M:%S")
+        return ParseLayout::ymd_hms_dash;
+    if (fmt == "%Y%m%d")
+        return ParseLayout::ymd_compact;
+
+    return ParseLayout::generic;
+}
+
+// The separator of the date fields of `fmt`: `-` for %F, or else the first `-`, `/` or `.` outside
+// of a conversion; 0 if there is none
+inline
+char
+format_date_separator(const std::string_view fmt)
+{
+    for (std::size_t i = 0; i < fmt.size(); ++i)
+    {
+        const char c{ fmt[i] };
+        if (c == '%')
+        {
+            // skip the width and modifiers to the conversion character
+            ++i;
+            while (i < fmt.size() && ((fmt[i] >= '0' && fmt[i] <= '9') || fmt[i] == 'E' ||
+                                      fmt[i] == 'O'))
+                ++i;
+            if (i < fmt.size() && fmt[i] == 'F')
+                return '-';
+            continue;
+        }
+
+        if (c == '-' || c == '/' || c == '.')
+            return c;
+    }
+
+    return 0;
+}
+
+struct parsed_fields
+{
+    int y{};
+    int m{};
+    int d{};
+    int h{};
+    int mi{};
+    int s{};
+};
+
+namespace detail
+{
+    // Value of the digit at `first`, which may be an ASCII digit or a Persian (U+06F0 to U+06F9)
+    // or Arabic-Indic (U+0660 to U+0669) digit in UTF-8, advancing `first` past it; -1 and
+    // `first` unchanged if there is no digit
+    inline
+    int
+    read_digit(const char*& first, const char* last)
+    {
+        if (first == last)
+            return -1;
+
+        const unsigned char c0{ static_cast<unsigned char>(first[0]) };
+        if (c0 >= '0' && c0 <= '9')
+        {
+            ++first;
+            return c0 - '0';
+        }
+
+        if ((c0 != 0xDB && c0 != 0xD9) || last - first < 2)
+            return -1;
+
+        const int zero{ c0 == 0xDB ? 0xB0 : 0xA0 };
+        const unsigned char c1{ static_cast<unsigned char>(first[1]) };
+        if (c1 < zero || c1 > zero + 9)
+            return -1;
+
+        first += 2;
+        return c1 - zero;
+    }
+
+    // reads `min_width` to `max_width` digits into `x`, as date::from_stream() does for an
+    // unsigned field
+    inline
+    bool
+    read_digits(const char*& first, const char* last, const int min_width, const int max_width,
+        int& x)
+    {
+        x = 0;
+        int n{ 0 };
+        for (int d; n < max_width && (d = read_digit(first, last)) >= 0; ++n)
+            x = 10 * x + d;
+
+        return n >= min_width;
+    }
+
+    inline
+    bool
+    read_digits(const char*& first, const char* last, const int width, int& x)
+    {
+        return read_digits(first, last, 1, width, x);
+    }
+
+    inline
+    bool
+    read_char(const char*& first, const char* last, const char c)
+    {
+        if (first == last || *first != c)
+            return false;
+
+        ++first;
+        return true;
+    }
+
+    // `sep` or U+060D ARABIC DATE SEPARATOR
+    inline
+    bool
+    read_date_sep(const char*& first, const char* last, const char sep)
+    {
+        if (read_char(first, last, sep))
+            return true;
+
+        if (last - first < 2 || static_cast<unsigned char>(first[0]) != 0xD8 ||
+            static_cast<unsigned char>(first[1]) != 0x8D)
+            return false;
+
+        first += 2;
+        return true;
+    }
+
+    inline
+    bool
+    read_ymd(const char*& first, const char* last, const char sep, parsed_fields& fds)
+    {
+        return read_digits(first, last, 4, fds.y) && read_date_sep(first, last, sep) &&
+            read_digits(first, last, 2, fds.m) && read_date_sep(first, last, sep) &&
+            read_digits(first, last, 2, fds.d);
+    }
+}
+
+// Copies `text` to `buf` with Persian and Arabic-Indic digits replaced by ASCII ones and, unless
+// `date_sep` is 0, U+060D ARABIC DATE SEPARATOR replaced by `date_sep`, for date::from_stream();
+// returns false, leaving `buf` alone, if `text` has nothing to replace
+inline
+bool
+normalize_digits(const std::string_view text, std::string& buf, const char date_sep)
+{
+    const char* first{ text.data() };
+    const char* last{ first + text.size() };
+
+    // skip the ASCII prefix
+    while (first != last && static_cast<unsigned char>(*first) < 0x80)
+        ++first;
+
+    if (first == last)
+        return false;
+
+    buf.assign(text.data(), first);
+    bool found{ false };
+    while (first != last)
+    {
+        const char* p{ first };
+        const bool ascii{ static_cast<unsigned char>(*first) < 0x80 };
+        const int d{ ascii ? -1 : detail::read_digit(p, last) };
+        if (d >= 0)
+        {
+            buf.push_back(static_cast<char>('0' + d));
+            found = true;
+            first = p;
+        }
+        else if (!ascii && date_sep && detail::read_date_sep(p, last, date_sep))
+        {
+            buf.push_back(date_sep);
+            found = true;
+            first = p;
+        }
+        else
+        {
+            buf.push_back(*first++);
+        }
+    }
+
+    return found;
+}
+
+// Parses [first, last) as `layout`. Digits may be ASCII, Persian or Arabic-Indic, and date
+// separators may also be U+060D ARABIC DATE SEPARATOR. Returns false if the input is not a plain
+// match, in which case it must be parsed by date::from_stream(); the fields are not validated
+// against the calendar.
+inline
+bool
+parse_fixed(const ParseLayout layout, const char* first, const char* last, parsed_fields& fds)
+{
+    using detail::read_char;
+    using detail::read_digits;
+
+    fds = parsed_fields{};
+    bool ok{ false };
+
+    switch (layout)
+    {
+    case ParseLayout::generic:
+        return false;
+    case ParseLayout::ymd_dash:
+        ok = detail::read_ymd(first, last, '-', fds);
+        break;
+    case ParseLayout::ymd_slash:
+        ok = detail::read_ymd(first, last, '/', fds);
+        break;
+    case ParseLayout::ymd_hms_dash:
+        ok = detail::read_ymd(first, last, '-', fds) && read_char(first, last, ' ') &&
+            read_digits(first, last, 2, fds.h) && read_char(first, last, ':') &&
+            read_digits(first, last, 2, fds.mi) && read_char(first, last, ':') &&
+            read_digits(first, last, 2, fds.s) &&
+            fds.h < 24 && fds.mi < 60 && fds.s < 60;
+        break;
+    case ParseLayout::ymd_compact:
+        // %Y and %m are read greedily, so only the full eight digits are unambiguous
+        ok = read_digits(first, last, 4, 4, fds.y) && read_digits(first, last, 2, 2, fds.m) &&
+            read_digits(first, last, 2, 2, fds.d);
+        break;
+    }
+
+    return ok && first == last;
+}
+
+#endif
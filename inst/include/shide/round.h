@@ -1,7 +1,9 @@
 #ifndef ROUND_H
 #define ROUND_H
 
+#include <cstdint>
 #include <optional>
+#include <type_traits>
 #include "shide/sh_year_month_day.h"
 #include "shide/tzdb.h"
 #include "shide/utils.h"
@@ -55,11 +57,28 @@ string_to_unit(const std::string& unit_name)
     return {};
 }
 
+// The floor and the ceiling of a value, found together so that the value is decomposed once
+template <class T>
+struct round_bounds
+{
+    T floor;
+    T ceiling;
+};
+
+// the nearest of the bounds of `x`, rounding up when `x` is halfway between them
+template <class T>
+constexpr
+T
+nearest(const T& x, const round_bounds<T>& bounds)
+{
+    return bounds.ceiling - x <= x - bounds.floor ? bounds.ceiling : bounds.floor;
+}
+
+// `ymd` holds the fields of `ld`, for callers that already decomposed it
 constexpr
 local_days
-floor_jdate(const local_days& ld, const Unit& unit, const int n)
+floor_jdate(const local_days& ld, const sh_year_month_day& ymd, const Unit& unit, const int n)
 {
-    sh_year_month_day ymd{ ld };
     sh_year_month_day ymd2{};
     int y{}, m{}, d{};
 
@@ -90,48 +109,17 @@ floor_jdate(const local_days& ld, const Unit& unit, const int n)
     return local_days{ ymd2 };
 }
 
-inline
-sys_seconds
-floor_jdatetime(const sys_seconds& tp, const date::time_zone* p_time_zone,
-    const Unit& unit, const int n)
+constexpr
+local_days
+floor_jdate(const local_days& ld, const Unit& unit, const int n)
 {
-    const auto ls = to_local_seconds(tp, p_time_zone);
-    const local_days ld{ date::floor<date::days>(ls) };
-    const auto tod = hour_minute_second{ ls - ld };
-    date::local_seconds ls_out{};
-    int h{}, m{}, s{};
-
-    switch (unit)
-    {
-    case Unit::year:
-    case Unit::quarter:
-    case Unit::month:
-    case Unit::week:
-    case Unit::day:
-        ls_out = date::local_seconds{ floor_jdate(ld, unit, n) };
-        break;
-    case Unit::hour:
-        h = floor_component1(tod.hours().count(), n);
-        ls_out = ld + std::chrono::hours{ h };
-        break;
-    case Unit::minute:
-        m = floor_component1(tod.minutes().count(), n);
-        ls_out = ld + tod.hours() + std::chrono::minutes{ m };
-        break;
-    case Unit::second:
-        s = floor_component1(tod.seconds().count(), n);
-        ls_out = ld + tod.hours() + tod.minutes() + std::chrono::seconds{ s };
-        break;
-    }
-
-    return to_sys_seconds(ls_out, p_time_zone);
+    return floor_jdate(ld, sh_year_month_day{ ld }, unit, n);
 }
 
 constexpr
 date::local_days
-ceiling_jdate(const local_days& ld, const Unit& unit, const int n)
+ceiling_jdate(const local_days& ld, const sh_year_month_day& ymd, const Unit& unit, const int n)
 {
-    sh_year_month_day ymd{ ld };
     sh_year_month_day ymd2{};
     int y{}, m{}, d{};
 
@@ -142,12 +130,14 @@ ceiling_jdate(const local_days& ld, const Unit& unit, const int n)
         ymd2 = sh_year_month_day{ date::year(y), date::month(1), date::day(1) };
         break;
     case Unit::quarter:
-        m = ceiling_component2(static_cast<unsigned>(ymd.month()), n * 3);
-        ymd2 = sh_year_month_day{ ymd.year(), date::month(m), date::day(1) };
-        break;
     case Unit::month:
-        m = ceiling_component2(static_cast<unsigned>(ymd.month()), n);
-        ymd2 = sh_year_month_day{ ymd.year(), date::month(m), date::day(1) };
+        m = ceiling_component2(static_cast<unsigned>(ymd.month()),
+                               unit == Unit::quarter ? n * 3 : n);
+        // periods that would run over the end of the year stop there
+        if (m > 12)
+            ymd2 = sh_year_month_day{ ymd.year() + date::years{ 1 }, date::month(1), date::day(1) };
+        else
+            ymd2 = sh_year_month_day{ ymd.year(), date::month(m), date::day(1) };
         break;
     case Unit::week:
         return ld + (date::days{ 7 } - sh_wday(ld)) + date::days{ 1 };
@@ -164,45 +154,217 @@ ceiling_jdate(const local_days& ld, const Unit& unit, const int n)
     return local_days{ ymd2 };
 }
 
-inline
-sys_seconds
-ceiling_jdatetime(const sys_seconds& tp, const date::time_zone* p_time_zone,
-    const Unit& unit, const int n)
+constexpr
+date::local_days
+ceiling_jdate(const local_days& ld, const Unit& unit, const int n)
+{
+    return ceiling_jdate(ld, sh_year_month_day{ ld }, unit, n);
+}
+
+namespace detail
 {
-    if (floor_jdatetime(tp, p_time_zone, unit, n) == tp)
-        return tp;
+    // `t` rounded down to a multiple of `step`
+    constexpr
+    std::int64_t
+    floor_multiple(const std::int64_t t, const std::int64_t step)
+    {
+        const std::int64_t r{ t % step };
+        return t - (r < 0 ? r + step : r);
+    }
+
+    // length of the time unit `U` and of the unit that `U`s are counted in, in seconds
+    template <Unit U>
+    constexpr std::int64_t unit_seconds{ U == Unit::second ? 1 : U == Unit::minute ? 60 : 3600 };
+
+    template <Unit U>
+    constexpr std::int64_t parent_seconds{ U == Unit::second ? 60 : U == Unit::minute ? 3600 : 86400 };
+}
+
+// Rounds local dates and times to `n` `U`s, specialized at compile time on the unit and on
+// `n == 1` (`One`) so that the loops over the elements don't switch on the unit. Time units work
+// on seconds with integer arithmetic alone. Date units remember the period of the last element,
+// as [first day, first day of the next period), and elements falling in it, as consecutive
+// elements of sorted or clustered input do, skip the calendar. The first day of the next period
+// is the ceiling of the elements in the period, so only elements outside of any period, whose
+// period is left empty, need a ceiling of their own, which floor() doesn't compute.
+template <Unit U, bool One>
+class round_kernel
+{
+    int n_;
+    // the last period; empty until the first element
+    local_days lo_{ date::days{ 1 } };
+    local_days hi_{ date::days{ 0 } };
+
+    void find_period(const local_days& ld)
+    {
+        const sh_year_month_day ymd{ ld };
+        lo_ = floor_jdate(ld, ymd, U, n_);
+        hi_ = ceiling_jdate(ld, ymd, U, n_);
+
+        if constexpr (U == Unit::year)
+        {
+            // the floors of negative years don't form periods
+            if (static_cast<int>(ymd.year()) < 0)
+                hi_ = lo_;
+        }
+
+        if (!(lo_ <= ld && ld < hi_))
+            hi_ = lo_;
+    }
+
+public:
+    explicit round_kernel(const int n) : n_{ n } {}
+
+    round_bounds<local_days> days(const local_days& ld)
+    {
+        if constexpr (U < Unit::day)
+        {
+            return { internal::nan_local_days, internal::nan_local_days };
+        }
+        else if constexpr (U == Unit::day && One)
+        {
+            return { ld, ld + date::days{ 1 } };
+        }
+        else
+        {
+            if (!(lo_ <= ld && ld < hi_))
+                find_period(ld);
+
+            if (lo_ <= ld && ld < hi_)
+                return { lo_, hi_ };
+
+            return { lo_, ceiling_jdate(ld, U, n_) };
+        }
+    }
+
+    local_days floor(const local_days& ld)
+    {
+        if constexpr (U < Unit::day)
+        {
+            return internal::nan_local_days;
+        }
+        else if constexpr (U == Unit::day && One)
+        {
+            return ld;
+        }
+        else
+        {
+            if (!(lo_ <= ld && ld < hi_))
+                find_period(ld);
+
+            return lo_;
+        }
+    }
+
+    round_bounds<local_seconds> seconds(const local_seconds& ls)
+    {
+        if constexpr (U < Unit::day)
+        {
+            constexpr std::int64_t step{ detail::unit_seconds<U> };
+            const std::int64_t t{ ls.time_since_epoch().count() };
+            std::int64_t lower{}, upper{};
 
-    const auto ls = to_local_seconds(tp, p_time_zone);
-    const local_days ld{ date::floor<date::days>(ls) };
-    const auto tod = hour_minute_second{ ls - ld };
-    date::local_seconds ls_out{};
-    int h{}, m{}, s{};
+            if constexpr (One)
+            {
+                lower = detail::floor_multiple(t, step);
+                upper = lower + step;
+            }
+            else
+            {
+                // multiples count from the start of the minute, hour or day
+                const std::int64_t first{ detail::floor_multiple(t, detail::parent_seconds<U>) };
+                lower = first + (t - first) / step / n_ * n_ * step;
+                upper = lower + n_ * step;
+            }
+
+            return { local_seconds{ std::chrono::seconds{ lower } },
+                     local_seconds{ std::chrono::seconds{ upper } } };
+        }
+        else
+        {
+            const auto bounds = days(date::floor<date::days>(ls));
+            return { local_seconds{ bounds.floor }, local_seconds{ bounds.ceiling } };
+        }
+    }
+
+    local_seconds floor(const local_seconds& ls)
+    {
+        if constexpr (U < Unit::day)
+            return seconds(ls).floor;
+        else
+            return local_seconds{ floor(date::floor<date::days>(ls)) };
+    }
+};
+
+// Calls `f` with the round_kernel for `n` `unit`s
+template <class F>
+decltype(auto)
+visit_round_kernel(const Unit unit, const int n, F f)
+{
+    const auto visit = [&](auto u) -> decltype(auto) {
+        constexpr Unit U{ decltype(u)::value };
+        return n == 1 ? f(round_kernel<U, true>{ n }) : f(round_kernel<U, false>{ n });
+    };
 
     switch (unit)
     {
-    case Unit::year:
-    case Unit::quarter:
-    case Unit::month:
-    case Unit::week:
-    case Unit::day:
-        ls_out = date::local_seconds{ ceiling_jdate(ld, unit, n) };
-        break;
-    case Unit::hour:
-        h = ceiling_component1(tod.hours().count(), n);
-        ls_out = ld + std::chrono::hours{ h };
-        break;
-    case Unit::minute:
-        m = ceiling_component1(tod.minutes().count(), n);
-        ls_out = ld + tod.hours() + std::chrono::minutes{ m };
-        break;
     case Unit::second:
-        s = ceiling_component1(tod.seconds().count(), n);
-        ls_out = ld + tod.hours() + tod.minutes() + std::chrono::seconds{ s };
-        break;
+        return visit(std::integral_constant<Unit, Unit::second>{});
+    case Unit::minute:
+        return visit(std::integral_constant<Unit, Unit::minute>{});
+    case Unit::hour:
+        return visit(std::integral_constant<Unit, Unit::hour>{});
+    case Unit::day:
+        return visit(std::integral_constant<Unit, Unit::day>{});
+    case Unit::week:
+        return visit(std::integral_constant<Unit, Unit::week>{});
+    case Unit::month:
+        return visit(std::integral_constant<Unit, Unit::month>{});
+    case Unit::quarter:
+        return visit(std::integral_constant<Unit, Unit::quarter>{});
+    default:
+        return visit(std::integral_constant<Unit, Unit::year>{});
     }
-
-    return to_sys_seconds(ls_out, p_time_zone);
 }
 
+// Rounds date-times to local time units of a time zone with a round_kernel. A time point is
+// converted to local time once, and its floor and ceiling are both found from it. They are
+// converted back through a local_info_cursor, which usually answers both from a single lookup
+// as they are close to each other, and subsequent elements too when the input is sorted. A time
+// point equal to its floor is its own ceiling.
+template <class Kernel>
+class jdatetime_rounder
+{
+    sys_info_cursor sys_cursor_;
+    local_info_cursor local_cursor_;
+    Kernel kernel_;
+
+public:
+    jdatetime_rounder(const sys_info_cursor& cursor, const Kernel& kernel)
+        : sys_cursor_{ cursor }, local_cursor_{ cursor.table() }, kernel_{ kernel }
+    {}
+
+    sys_seconds floor(const sys_seconds& tp)
+    {
+        const auto ls = to_local_seconds(tp, sys_cursor_);
+        return to_sys_seconds(kernel_.floor(ls), local_cursor_);
+    }
+
+    round_bounds<sys_seconds> bounds(const sys_seconds& tp)
+    {
+        const auto ls = to_local_seconds(tp, sys_cursor_);
+        const auto local = kernel_.seconds(ls);
+
+        const sys_seconds lower{ to_sys_seconds(local.floor, local_cursor_) };
+        if (lower == tp)
+            return { tp, tp };
+
+        return { lower, to_sys_seconds(local.ceiling, local_cursor_) };
+    }
+
+    sys_seconds ceiling(const sys_seconds& tp) { return bounds(tp).ceiling; }
+
+    sys_seconds round(const sys_seconds& tp) { return nearest(tp, bounds(tp)); }
+};
 
 #endif
@@ -1,6 +1,7 @@
 #ifndef SEQ_H
 #define SEQ_H
 
+#include <optional>
 #include "shide/sh_year_month_day.h"
 
 constexpr
@@ -19,4 +20,51 @@ sh_date_is_leap(const sh_year_month_day& ymd) {
 	return (ymd.month() == date::month(12)) && (ymd.day() == date::day(30));
 }
 
+// The dates of a sequence that steps by `n` months or years from the date `from`, each computed
+// from its index with calendar arithmetic on the fields of `from`. A day that doesn't exist in its
+// month rolls forward to the first day of the next month.
+class jdate_calendar_seq
+{
+	sh_year_month_day ymd_;
+	int n_;
+	bool years_;
+
+public:
+	jdate_calendar_seq(const int from, const int n, const bool years)
+		: ymd_{ date::local_days{ date::days{ from } } }, n_{ n }, years_{ years }
+	{}
+
+	// the days since the epoch of element `k`, if it is within the calendar
+	std::optional<int> operator()(const std::int64_t k) const
+	{
+		// far beyond the calendar in either unit; also keeps the steps within an int
+		constexpr std::int64_t max_steps{
+			12 * (internal::UPPER_PERSIAN_YEAR - internal::LOWER_PERSIAN_YEAR + 1) };
+		const std::int64_t steps{ k * n_ };
+		if (steps > max_steps || steps < -max_steps)
+			return {};
+
+		sh_year_month_day ymd{ years_ ?
+			ymd_ + date::years{ static_cast<int>(steps) } :
+			ymd_ + date::months{ static_cast<int>(steps) } };
+		if (!ymd.ok())
+			ymd = first_day_next_month(ymd);
+		if (!ymd.ok())
+			return {};
+
+		return static_cast<int>(local_days(ymd).time_since_epoch().count());
+	}
+
+	// the number of months or years between the fields of `from` and of `ymd`
+	std::int64_t steps_to(const sh_year_month_day& ymd) const
+	{
+		const std::int64_t years{ static_cast<int>(ymd.year()) - static_cast<int>(ymd_.year()) };
+		if (years_)
+			return years;
+
+		return 12 * years + static_cast<std::int64_t>(static_cast<unsigned>(ymd.month())) -
+			static_cast<std::int64_t>(static_cast<unsigned>(ymd_.month()));
+	}
+};
+
 #endif
@@ -1,5 +1,6 @@
 #ifndef SH_YEAR_MONTH_DAY_H
 #define SH_YEAR_MONTH_DAY_H
+#include <cstdint>
 #include "shide/date.h"
 
 namespace internal
@@ -59,19 +60,132 @@ namespace detail
 
 	constexpr
 	inline
-	int 
-	approx_year(int jd)
+	int
+	jalali_jd0_last_block(const int year)
 	{
-		constexpr int calendar_epoch{ internal::JALALI_ZERO + 1 };
-		constexpr int n1{ 2820 }; /* exact values which overflow on 32 bits */
-		constexpr int n2{ 2820 * 365 + 683 };
-
-		jd -= calendar_epoch;
-		const int day_in_cycle{ mod(jd, n2) };
-		const double tmp{ (static_cast<double>(n1) / n2) * day_in_cycle };
-		int year{ n1 * ((jd - day_in_cycle) / n2) };
-		year += static_cast<int>(tmp);
-		return year;
+		// jalali_jd0() rejects UPPER_PERSIAN_YEAR + 1, but its start is still needed
+		// to know where UPPER_PERSIAN_YEAR ends
+		return internal::JALALI_ZERO + year * 365 + (852 + year * 303) / 1250;
+	}
+
+	struct year_start_table
+	{
+		static constexpr int size{ internal::UPPER_PERSIAN_YEAR - internal::LOWER_PERSIAN_YEAR + 2 };
+		int jd0[size];
+
+		constexpr year_start_table() : jd0()
+		{
+			using namespace internal;
+			for (int i{ 0 }; i < size - 1; ++i)
+				jd0[i] = jalali_jd0(LOWER_PERSIAN_YEAR + i);
+			jd0[size - 1] = jalali_jd0_last_block(UPPER_PERSIAN_YEAR + 1);
+		}
+	};
+
+	// jd0[i] is the julian day preceding the first day of year LOWER_PERSIAN_YEAR + i
+	inline constexpr year_start_table YEAR_START{};
+
+	struct leap_year_bits
+	{
+		static constexpr int size{ year_start_table::size - 1 };
+		std::uint64_t words[(size + 63) / 64];
+
+		constexpr leap_year_bits() : words()
+		{
+			for (int i{ 0 }; i < size; ++i)
+			{
+				if (YEAR_START.jd0[i + 1] - YEAR_START.jd0[i] == 366)
+					words[i / 64] |= std::uint64_t{ 1 } << (i % 64);
+			}
+		}
+	};
+
+	// bit i is set if year LOWER_PERSIAN_YEAR + i has 366 days
+	inline constexpr leap_year_bits LEAP_YEARS{};
+
+	// y must be within [LOWER_PERSIAN_YEAR, UPPER_PERSIAN_YEAR]
+	constexpr
+	inline
+	bool
+	is_leap(const int y)
+	{
+		const int i{ y - internal::LOWER_PERSIAN_YEAR };
+		return (LEAP_YEARS.words[i / 64] >> (i % 64)) & 1;
+	}
+
+	constexpr
+	inline
+	int
+	days_in_month(const int y, const int m)
+	{
+		return m <= 6 ? 31 : m < 12 ? 30 : 29 + is_leap(y);
+	}
+
+	constexpr
+	inline
+	int
+	year_index(const int jd)
+	{
+		// 12053 days in a 33-year cycle; the estimate is never more than one year off
+		// over the supported range, so two comparisons settle it
+		constexpr int first_jd{ YEAR_START.jd0[0] + 1 };
+		int i{ static_cast<int>((static_cast<long long>(jd - first_jd) * 33) / 12053) };
+		i = i < year_start_table::size - 2 ? i : year_start_table::size - 2;
+		i -= jd <= YEAR_START.jd0[i];
+		i += jd > YEAR_START.jd0[i + 1];
+		return i;
+	}
+
+	constexpr
+	inline
+	bool
+	jd_in_range(const int jd)
+	{
+		return jd > YEAR_START.jd0[0] && jd <= YEAR_START.jd0[year_start_table::size - 1];
+	}
+
+	struct ymd_parts
+	{
+		int y;
+		int m;
+		int d;
+	};
+
+	// jd must satisfy jd_in_range()
+	constexpr
+	inline
+	ymd_parts
+	split_jd(const int jd)
+	{
+		const int i{ year_index(jd) };
+		const int doy0{ jd - YEAR_START.jd0[i] - 1 };
+
+		// first six months have 31 days and the rest have 30 (29 for Esfand of common years)
+		const int m{ doy0 < 186 ? doy0 / 31 + 1 : (doy0 - 186) / 30 + 7 };
+		const int d{ doy0 < 186 ? doy0 % 31 + 1 : (doy0 - 186) % 30 + 1 };
+		return ymd_parts{ internal::LOWER_PERSIAN_YEAR + i, m, d };
+	}
+
+	constexpr
+	inline
+	bool
+	ymd_ok(const int y, const int m, const int d)
+	{
+		using namespace internal;
+		if (y < LOWER_PERSIAN_YEAR || y > UPPER_PERSIAN_YEAR || m < 1 || m > 12 || d < 1)
+			return false;
+
+		return d <= days_in_month(y, m);
+	}
+
+	// y, m and d must satisfy ymd_ok()
+	constexpr
+	inline
+	int
+	ymd_to_jd(const int y, const int m, const int d)
+	{
+		using namespace internal;
+		return YEAR_START.jd0[y - LOWER_PERSIAN_YEAR] + MONTH_DATA_CUM[m - 1] + d;
 	}
 }
 
@@ -89,8 +203,9 @@ inline
 bool
 year_is_leap(const date::year& y)
 {
-	using namespace detail;
-	return (jalali_jd0(static_cast<int>(y)+1) - jalali_jd0(static_cast<int>(y)) == 366);
+	using namespace internal;
+	const int yy{ static_cast<int>(y) };
+	return yy >= LOWER_PERSIAN_YEAR && yy <= UPPER_PERSIAN_YEAR && detail::is_leap(yy);
 }
 
 class sh_year_month_day
@@ -194,9 +309,8 @@ inline
 bool
 sh_year_month_day::ok() const NOEXCEPT
 {
-	if (!(y_.ok() && m_.ok()))
-		return false;
-	return date::day{ 1 } <= d_ && d_ <= sh_year_month_day_last{y_, (m_ / last)}.day();
+	return detail::ymd_ok(static_cast<int>(y_), static_cast<int>(static_cast<unsigned>(m_)),
+		static_cast<int>(static_cast<unsigned>(d_)));
 }
 
 constexpr
@@ -209,7 +323,9 @@ sh_year_month_day::to_days() const NOEXCEPT
 	auto const y = static_cast<int>(y_);
 	auto const m = static_cast<int>(static_cast<unsigned>(m_));
 	auto const d = static_cast<int>(static_cast<unsigned>(d_));
-	return days{ jalali_jd0(y) + MONTH_DATA_CUM[m - 1] + d - JD_UNIX_EPOCH };
+	const int jd0{ y >= LOWER_PERSIAN_YEAR && y <= UPPER_PERSIAN_YEAR ?
+		YEAR_START.jd0[y - LOWER_PERSIAN_YEAR] : 0 };
+	return days{ jd0 + MONTH_DATA_CUM[m - 1] + d - JD_UNIX_EPOCH };
 }
 
 constexpr
@@ -226,42 +342,13 @@ sh_year_month_day::from_days(days dp) NOEXCEPT
 {
 	using namespace internal;
 	using namespace detail;
-	auto const jd = dp.count() + JD_UNIX_EPOCH;
-	int m{ 1 };
-	int y{ approx_year(jd) };
-	int year_ends[2]{};
-	do
-	{
-		year_ends[0] = jalali_jd0(y) + 1;
-		year_ends[1] = jalali_jd0(y + 1);
-		assert(year_ends[0] && year_ends[1]);
+	const int jd{ static_cast<int>(dp.count()) + JD_UNIX_EPOCH };
 
-		if (year_ends[0] > jd)
-		{
-			y--;
-			continue;
-		}
-
-		if (year_ends[1] < jd)
-		{
-			y++;
-			continue;
-		}
-
-	} while (year_ends[0] > jd || year_ends[1] < jd);
-
-	const int doy{ jd - year_ends[0] + 1 };
-	for (int i{ 1 }; i < 13; ++i)
-	{
-		if (doy <= MONTH_DATA_CUM[i])
-		{
-			m = i;
-			break;
-		}
-	}
+	if (!jd_in_range(jd))
+		return sh_year_month_day{ date::nanyear, date::month(0), date::day(0) };
 
-	const int d{ doy - MONTH_DATA_CUM[m - 1] };
-	return sh_year_month_day{ date::year(y), date::month(m), date::day(d) };
+	const auto p = split_jd(jd);
+	return sh_year_month_day{ date::year(p.y), date::month(p.m), date::day(p.d) };
 }
 
 constexpr
@@ -3,12 +3,106 @@
 
 #include "shide/sh_year_month_day.h"
 #include "shide/tzdb.h"
+#include "shide/zone_table.h"
+#include <limits>
+#include <optional>
+#include <utility>
 
 using date::sys_seconds;
 using date::local_seconds;
 using date::sys_info;
 using date::local_info;
 
+// The interval of `table` holding all the non-missing seconds since the epoch in `x`, if there is
+// one. Zones without transitions, such as UTC, and input within one offset period, such as times
+// in Asia/Tehran after DST was abolished, can then be converted with a single offset.
+inline
+std::optional<zone_interval>
+common_interval(const zone_table& table, const double* x, const std::size_t size)
+{
+    double lo{ std::numeric_limits<double>::infinity() };
+    double hi{ -lo };
+    for (std::size_t i = 0; i < size; ++i)
+    {
+        // NaN compares false and is skipped
+        lo = x[i] < lo ? x[i] : lo;
+        hi = x[i] > hi ? x[i] : hi;
+    }
+
+    // also rejects empty or all missing input
+    constexpr double max_seconds{ 1e18 };
+    if (!(lo >= -max_seconds && hi <= max_seconds))
+        return {};
+
+    const auto interval = table.sys_interval(sys_seconds{ std::chrono::seconds{ static_cast<long long>(lo) } });
+    if (sys_seconds{ std::chrono::seconds{ static_cast<long long>(hi) } } >= interval.end)
+        return {};
+
+    return interval;
+}
+
+// Remembers the intervals of the last two lookups in a compiled zone, so that time points falling
+// in either [begin, end) interval are resolved without searching the table. Sorted input then only
+// searches once per transition, and input going back and forth over a transition keeps hitting
+// both sides of it.
+class sys_info_cursor
+{
+    const zone_table* table_;
+    zone_interval cur_{};
+    zone_interval prev_{};
+
+public:
+    explicit sys_info_cursor(const zone_table& table) : table_{ &table } {}
+
+    // starts at the interval holding all of `x`, if there is one, so that no element of `x` needs
+    // a search
+    sys_info_cursor(const zone_table& table, const double* x, const std::size_t size)
+        : table_{ &table }
+    {
+        if (const auto interval = common_interval(table, x, size))
+            cur_ = *interval;
+    }
+
+    const zone_table& table() const { return *table_; }
+
+    const zone_interval& operator()(const sys_seconds& tp)
+    {
+        if (tp >= cur_.begin && tp < cur_.end)
+            return cur_;
+
+        std::swap(cur_, prev_);
+
+        if (tp < cur_.begin || tp >= cur_.end)
+            cur_ = table_->sys_interval(tp);
+
+        return cur_;
+    }
+};
+
+// Remembers the result of the last local time lookup in a compiled zone together with the range
+// of local times around it that share the result, so that following rows in that range, whether
+// unique, ambiguous or nonexistent, are answered without searching the table.
+class local_info_cursor
+{
+    const zone_table* table_;
+    zone_local_info info_{};
+    local_seconds lo_{};
+    local_seconds hi_{};
+
+public:
+    explicit local_info_cursor(const zone_table& table) : table_{ &table } {}
+
+    const zone_table& table() const { return *table_; }
+
+    const zone_local_info& operator()(const local_seconds& tp)
+    {
+        if (tp < lo_ || tp >= hi_)
+            info_ = table_->local_info(tp, lo_, hi_);
+
+        return info_;
+    }
+};
+
 inline
 local_seconds
 to_local_seconds(const sys_seconds& tp, const date::time_zone* p_time_zone, sys_info& info)
@@ -26,6 +120,13 @@ to_local_seconds(const sys_seconds& tp, const date::time_zone* p_time_zone)
     return local_seconds{ (tp + info.offset).time_since_epoch() };
 }
 
+inline
+local_seconds
+to_local_seconds(const sys_seconds& tp, sys_info_cursor& cursor)
+{
+    return local_seconds{ (tp + cursor(tp).offset).time_since_epoch() };
+}
+
 inline
 local_days
 to_local_days(const sys_seconds& tp, const date::time_zone* p_time_zone, sys_info& info)
@@ -33,6 +134,13 @@ to_local_days(const sys_seconds& tp, const date::time_zone* p_time_zone, sys_inf
     return date::floor<date::days>(to_local_seconds(tp, p_time_zone, info));
 }
 
+inline
+local_days
+to_local_days(const sys_seconds& tp, sys_info_cursor& cursor)
+{
+    return date::floor<date::days>(to_local_seconds(tp, cursor));
+}
+
 inline
 sys_seconds
 to_sys_seconds(const local_seconds& tp, const date::time_zone* p_time_zone, local_info& info)
@@ -41,6 +149,20 @@ to_sys_seconds(const local_seconds& tp, const date::time_zone* p_time_zone, loca
     return sys_seconds{ tp.time_since_epoch() - info.first.offset };
 }
 
+inline
+sys_seconds
+to_sys_seconds(const local_seconds& tp, const zone_table& table)
+{
+    return sys_seconds{ tp.time_since_epoch() - table.local_info(tp).first.offset };
+}
+
+inline
+sys_seconds
+to_sys_seconds(const local_seconds& tp, local_info_cursor& cursor)
+{
+    return sys_seconds{ tp.time_since_epoch() - cursor(tp).first.offset };
+}
+
 inline
 sys_seconds
 to_sys_seconds(const local_seconds& tp, const date::time_zone* p_time_zone)
@@ -0,0 +1,245 @@
+#ifndef ZONE_TABLE_H
+#define ZONE_TABLE_H
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "shide/sh_year_month_day.h"
+#include "shide/tzdb.h"
+
+// An interval [begin, end) of constant offset of a compiled zone. `abbrev` indexes the
+// abbreviations of the zone, see zone_table::abbrev().
+struct zone_interval
+{
+    date::sys_seconds begin;
+    date::sys_seconds end;
+    std::chrono::seconds offset;
+    std::chrono::minutes save;
+    int abbrev;
+};
+
+// Counterpart of date::local_info. `result` takes the values of date::local_info::result.
+struct zone_local_info
+{
+    int result;
+    zone_interval first;
+    zone_interval second;
+};
+
+// A time zone compiled into flat arrays of transition instants, offsets and interned
+// abbreviations, so that lookups need neither a search through the zone rules nor a copy of the
+// abbreviation string. Time points before the first or after the last compiled transition belong
+// to the first or the last interval.
+class zone_table
+{
+    static constexpr std::int64_t MIN_SECONDS{ -(std::int64_t{ 1 } << 62) };
+    static constexpr std::int64_t MAX_SECONDS{ std::int64_t{ 1 } << 62 };
+
+    const date::time_zone* tz_;
+    // one more element than the other arrays, the last one being MAX_SECONDS
+    std::vector<std::int64_t> begin_;
+    std::vector<std::int32_t> offset_;
+    std::vector<std::int32_t> save_;
+    std::vector<std::int32_t> abbrev_;
+    std::vector<std::string> abbrevs_;
+
+    int intern(const std::string& abbrev)
+    {
+        for (std::size_t i = 0; i < abbrevs_.size(); ++i)
+        {
+            if (abbrevs_[i] == abbrev)
+                return static_cast<int>(i);
+        }
+
+        abbrevs_.push_back(abbrev);
+        return static_cast<int>(abbrevs_.size() - 1);
+    }
+
+    void push(const std::int64_t begin, const date::sys_info& info)
+    {
+        begin_.push_back(begin);
+        offset_.push_back(static_cast<std::int32_t>(info.offset.count()));
+        save_.push_back(static_cast<std::int32_t>(info.save.count()));
+        abbrev_.push_back(intern(info.abbrev));
+    }
+
+public:
+    // compiles the transitions of `tz` from Jalali year `first` through `last`; throws
+    // std::runtime_error if the time zone database has none
+    zone_table(const date::time_zone* tz, const int first, const int last)
+        : tz_{ tz }
+    {
+        using detail::YEAR_START;
+        using internal::JD_UNIX_EPOCH;
+        using internal::LOWER_PERSIAN_YEAR;
+
+        // a day of margin on both sides covers every UTC offset
+        date::sys_seconds tp{ date::sys_days{
+            date::days{ YEAR_START.jd0[first - LOWER_PERSIAN_YEAR] - JD_UNIX_EPOCH - 1 } } };
+        const date::sys_seconds last_tp{ date::sys_days{
+            date::days{ YEAR_START.jd0[last + 1 - LOWER_PERSIAN_YEAR] - JD_UNIX_EPOCH + 2 } } };
+
+        date::sys_info info;
+        while (tzdb::get_sys_info(tp, tz, info))
+        {
+            push(begin_.empty() ? MIN_SECONDS : info.begin.time_since_epoch().count(), info);
+            if (info.end >= last_tp)
+                break;
+
+            tp = info.end;
+        }
+
+        // offsets that silently fell back to UTC would be wrong
+        if (begin_.empty())
+            throw std::runtime_error("Can't find the offsets of time zone " + tz->name() + ".");
+
+        begin_.push_back(MAX_SECONDS);
+    }
+
+    const date::time_zone* zone() const { return tz_; }
+
+    std::size_t size() const { return offset_.size(); }
+
+    // index of the interval that contains `t` seconds since the epoch
+    std::size_t index(const std::int64_t t) const
+    {
+        // branchless binary search for the last interval beginning at or before `t`, which
+        // exists as the first interval begins at MIN_SECONDS
+        const std::int64_t* base{ begin_.data() };
+        std::size_t n{ size() };
+        while (n > 1)
+        {
+            const std::size_t half{ n / 2 };
+            base = base[half] <= t ? base + half : base;
+            n -= half;
+        }
+
+        return static_cast<std::size_t>(base - begin_.data());
+    }
+
+    zone_interval interval(const std::size_t i) const
+    {
+        return zone_interval{
+            date::sys_seconds{ std::chrono::seconds{ begin_[i] } },
+            date::sys_seconds{ std::chrono::seconds{ begin_[i + 1] } },
+            std::chrono::seconds{ offset_[i] },
+            std::chrono::minutes{ save_[i] },
+            abbrev_[i]
+        };
+    }
+
+    zone_interval sys_interval(const date::sys_seconds& tp) const
+    {
+        return interval(index(tp.time_since_epoch().count()));
+    }
+
+    zone_local_info local_info(const date::local_seconds& tp) const
+    {
+        date::local_seconds lo;
+        date::local_seconds hi;
+        return local_info(tp, lo, hi);
+    }
+
+    // also sets [lo, hi) to the range of local times around `tp` that have the same result
+    zone_local_info local_info(const date::local_seconds& tp, date::local_seconds& lo,
+        date::local_seconds& hi) const
+    {
+        const std::int64_t t{ tp.time_since_epoch().count() };
+
+        // offsets are shorter than the time between transitions, so the intervals that may hold
+        // `tp` are the one holding it as a sys time and its neighbours
+        const std::size_t i{ index(t) };
+        const std::size_t first{ i > 0 ? i - 1 : 0 };
+        const std::size_t last{ i + 1 < size() ? i + 1 : i };
+
+        zone_local_info out{ date::local_info::nonexistent, {}, {} };
+        std::int64_t range_lo{ t };
+        std::int64_t range_hi{ t };
+        std::size_t k0{ last + 1 };
+        int found{ 0 };
+
+        for (std::size_t k = first; k <= last; ++k)
+        {
+            if (t >= begin_[k] + offset_[k] && t < begin_[k + 1] + offset_[k])
+            {
+                k0 = found == 0 ? k : k0;
+                ++found;
+            }
+        }
+
+        if (found == 1)
+        {
+            const std::int32_t before{ k0 > 0 ? offset_[k0 - 1] : offset_[k0] };
+            const std::int32_t after{ k0 + 1 < size() ? offset_[k0 + 1] : offset_[k0] };
+            out.result = date::local_info::unique;
+            out.first = interval(k0);
+            range_lo = begin_[k0] + std::max(offset_[k0], before);
+            range_hi = begin_[k0 + 1] + std::min(offset_[k0], after);
+        }
+        else if (found == 2)
+        {
+            out.result = date::local_info::ambiguous;
+            out.first = interval(k0);
+            out.second = interval(k0 + 1);
+            range_lo = begin_[k0 + 1] + offset_[k0 + 1];
+            range_hi = begin_[k0 + 1] + offset_[k0];
+        }
+        else
+        {
+            // `tp` was skipped by the transition between two of the intervals
+            for (std::size_t k = first; k < last; ++k)
+            {
+                if (t >= begin_[k + 1] + offset_[k] && t < begin_[k + 1] + offset_[k + 1])
+                {
+                    out.first = interval(k);
+                    out.second = interval(k + 1);
+                    range_lo = begin_[k + 1] + offset_[k];
+                    range_hi = begin_[k + 1] + offset_[k + 1];
+                    break;
+                }
+            }
+        }
+
+        lo = date::local_seconds{ std::chrono::seconds{ range_lo } };
+        hi = date::local_seconds{ std::chrono::seconds{ range_hi } };
+        return out;
+    }
+
+    const std::string& abbrev(const zone_interval& interval) const
+    {
+        return abbrevs_[interval.abbrev];
+    }
+};
+
+// Returns the compiled zone named `name`, or nullptr if it is not in the time zone database.
+// Zones are compiled over the supported range of Jalali years on first use and kept for the
+// lifetime of the process. The cache is guarded by a mutex, so this may be called from any
+// thread, though the kernels locate their zones before starting worker threads.
+inline
+const zone_table*
+locate_zone_table(const std::string& name)
+{
+    static std::mutex mutex;
+    static std::unordered_map<std::string, std::unique_ptr<const zone_table>> cache;
+
+    const std::lock_guard<std::mutex> lock{ mutex };
+
+    const auto it = cache.find(name);
+    if (it != cache.end())
+        return it->second.get();
+
+    const date::time_zone* tz{};
+    if (!tzdb::locate_zone(name, tz))
+        return nullptr;
+
+    auto table = std::make_unique<const zone_table>(
+        tz, internal::LOWER_PERSIAN_YEAR, internal::UPPER_PERSIAN_YEAR);
+    return cache.emplace(name, std::move(table)).first->second.get();
+}
+
+#endif
@@ -1,4 +1,6 @@
 #include "shide.h"
+#include <shide/batch.h>
+#include <shide/components.h>
 #include <shide/make.h>
 #include <shide/utils.h>
 
@@ -8,27 +10,14 @@ std::string get_current_tzone_cpp();
 cpp11::writable::list
 jdate_get_fields_cpp(const cpp11::sexp x)
 {
-    const cpp11::doubles xx = cpp11::as_cpp<cpp11::doubles>(x);
-    const R_xlen_t size = xx.size();
+    const R_xlen_t size = Rf_xlength(x);
     cpp11::writable::integers year(size);
     cpp11::writable::integers month(size);
     cpp11::writable::integers day(size);
 
-    for (R_xlen_t i = 0; i < size; ++i)
-    {
-        if (std::isnan(xx[i]))
-        {
-            year[i] = NA_INTEGER;
-            month[i] = NA_INTEGER;
-            day[i] = NA_INTEGER;
-            continue;
-        }
-
-        auto ymd = sh_year_month_day{ date::local_days{ date::days(static_cast<int>(xx[i])) } };
-        year[i] = int{ ymd.year() };
-        month[i] = static_cast<int>(unsigned{ ymd.month() });
-        day[i] = static_cast<int>(unsigned{ ymd.day() });
-    }
+    visit_days(x, [&](const auto* xx) {
+        sh_ymd_from_days(xx, size, INTEGER(year), INTEGER(month), INTEGER(day), NA_INTEGER);
+    });
 
     cpp11::writable::list out({year, month, day});
     out.names() = {"year", "month", "day"};
@@ -42,20 +31,23 @@ jdatetime_get_fields_cpp(const cpp11::sexp x)
     const cpp11::doubles xx = cpp11::as_cpp<cpp11::doubles>(x);
     const cpp11::strings tz_name_ =  cpp11::as_cpp<cpp11::strings>(x.attr("tzone"));
     std::string tz_name(tz_name_[0]);
-    const date::time_zone* tz{};
 
     if (!tz_name.size())
     {
         tz_name = get_current_tzone_cpp();
     }
 
-    if (!tzdb::locate_zone(tz_name, tz))
+    const zone_table* table{ locate_zone_table(tz_name) };
+    if (!table)
     {
         cpp11::stop(std::string(tz_name + " not found in timezone database").c_str());
     }
 
-    date::sys_seconds ss;
-    date::sys_info info;
+    date::local_seconds ls;
+    date::local_days ld;
+    sys_info_cursor tz_cursor{ *table };
+    sh_ymd_cursor cursor;
+    int jd{};
 
     const R_xlen_t size = xx.size();
     cpp11::writable::integers year(size);
@@ -65,28 +57,80 @@ jdatetime_get_fields_cpp(const cpp11::sexp x)
     cpp11::writable::integers minute(size);
     cpp11::writable::integers second(size);
 
-    for (R_xlen_t i = 0; i < size; ++i)
+    // with a single offset, local days and times of day are plain arithmetic and the days go
+    // through the batch conversion used for jdate
+    if (const auto interval = common_interval(*table, REAL(xx), size))
     {
-        if (std::isnan(xx[i]))
+        const double* p_x = REAL(xx);
+        const long long offset{ interval->offset.count() };
+        std::vector<double> days(size);
+        std::vector<int> tod(size);
+
+        for (R_xlen_t i = 0; i < size; ++i)
         {
-            year[i] = NA_INTEGER;
-            month[i] = NA_INTEGER;
-            day[i] = NA_INTEGER;
-            hour[i] = NA_INTEGER;
-            minute[i] = NA_INTEGER;
-            second[i] = NA_INTEGER;
-            continue;
+            const bool na{ std::isnan(p_x[i]) };
+            const long long t{ static_cast<long long>(na ? 0.0 : p_x[i]) + offset };
+            const long long d{ t / 86400 - (t % 86400 < 0) };
+            days[i] = na ? NA_REAL : static_cast<double>(d);
+            tod[i] = static_cast<int>(t - d * 86400);
         }
 
-        ss = sys_seconds_from_double(xx[i]);
-        auto fds = make_sh_fields( to_local_seconds(ss, tz, info) );
+        int* p_year = INTEGER(year);
+        int* p_hour = INTEGER(hour);
+        int* p_minute = INTEGER(minute);
+        int* p_second = INTEGER(second);
+        sh_ymd_from_days(days.data(), size, p_year, INTEGER(month), INTEGER(day), NA_INTEGER);
 
-        year[i] = int{ fds.ymd.year() };
-        month[i] = static_cast<int>(unsigned{ fds.ymd.month() });
-        day[i] = static_cast<int>(unsigned{ fds.ymd.day() });
-        hour[i] = fds.tod.hours().count();
-        minute[i] = fds.tod.minutes().count();
-        second[i] = static_cast<int>(fds.tod.seconds().count());
+        for (R_xlen_t i = 0; i < size; ++i)
+        {
+            const bool ok{ p_year[i] != NA_INTEGER };
+            p_hour[i] = ok ? tod[i] / 3600 : NA_INTEGER;
+            p_minute[i] = ok ? tod[i] / 60 % 60 : NA_INTEGER;
+            p_second[i] = ok ? tod[i] % 60 : NA_INTEGER;
+        }
+    }
+    else
+    {
+        for (R_xlen_t i = 0; i < size; ++i)
+        {
+            if (i > 0 && xx[i] == xx[i - 1])
+            {
+                year[i] = year[i - 1];
+                month[i] = month[i - 1];
+                day[i] = day[i - 1];
+                hour[i] = hour[i - 1];
+                minute[i] = minute[i - 1];
+                second[i] = second[i - 1];
+                continue;
+            }
+
+            if (!std::isnan(xx[i]))
+            {
+                ls = to_local_seconds(sys_seconds_from_double(xx[i]), tz_cursor);
+                ld = date::floor<date::days>(ls);
+                jd = static_cast<int>(ld.time_since_epoch().count()) + internal::JD_UNIX_EPOCH;
+            }
+
+            if (std::isnan(xx[i]) || !detail::jd_in_range(jd))
+            {
+                year[i] = NA_INTEGER;
+                month[i] = NA_INTEGER;
+                day[i] = NA_INTEGER;
+                hour[i] = NA_INTEGER;
+                minute[i] = NA_INTEGER;
+                second[i] = NA_INTEGER;
+                continue;
+            }
+
+            const auto p = cursor(jd);
+            const auto tod = hour_minute_second{ ls - ld };
+            year[i] = p.y;
+            month[i] = p.m;
+            day[i] = p.d;
+            hour[i] = tod.hours().count();
+            minute[i] = tod.minutes().count();
+            second[i] = static_cast<int>(tod.seconds().count());
+        }
     }
 
     cpp11::writable::list out({year, month, day, hour, minute, second});
@@ -98,21 +142,12 @@ jdatetime_get_fields_cpp(const cpp11::sexp x)
 cpp11::writable::integers
 jdate_get_yday_cpp(const cpp11::sexp x)
 {
-    const cpp11::doubles xx = cpp11::as_cpp<cpp11::doubles>(x);
-    const R_xlen_t size = xx.size();
+    const R_xlen_t size = Rf_xlength(x);
     cpp11::writable::integers out(size);
 
-    for (R_xlen_t i = 0; i < size; ++i)
-    {
-        if (std::isnan(xx[i]))
-        {
-            out[i] = NA_INTEGER;
-            continue;
-        }
-
-        auto ymd = sh_year_month_day{ date::local_days{ date::days(static_cast<int>(xx[i])) } };
-        out[i] = sh_yday(ymd).count();
-    }
+    visit_days(x, [&](const auto* xx) {
+        sh_yday_from_days(xx, size, INTEGER(out), NA_INTEGER);
+    });
 
     return out;
 }
@@ -121,44 +156,169 @@ jdate_get_yday_cpp(const cpp11::sexp x)
 cpp11::writable::integers
 jdate_get_wday_cpp(const cpp11::sexp x)
 {
-    const cpp11::doubles xx = cpp11::as_cpp<cpp11::doubles>(x);
-    const R_xlen_t size = xx.size();
+    const R_xlen_t size = Rf_xlength(x);
     cpp11::writable::integers out(size);
-    date::local_days ld{};
 
-    for (R_xlen_t i = 0; i < size; ++i)
+    visit_days(x, [&](const auto* xx) {
+        sh_wday_from_days(xx, size, INTEGER(out), NA_INTEGER);
+    });
+
+    return out;
+}
+
+[[cpp11::register]]
+cpp11::writable::integers
+jdate_get_qday_cpp(const cpp11::sexp x)
+{
+    const R_xlen_t size = Rf_xlength(x);
+    cpp11::writable::integers out(size);
+
+    visit_days(x, [&](const auto* xx) {
+        sh_qday_from_days(xx, size, INTEGER(out), NA_INTEGER);
+    });
+
+    return out;
+}
+
+static
+std::vector<Component>
+parse_components(const cpp11::strings& components, const bool has_tod)
+{
+    std::vector<Component> out;
+    out.reserve(components.size());
+
+    for (R_xlen_t j = 0; j < components.size(); ++j)
+    {
+        const std::string component_name(components[j]);
+        const auto opt{ string_to_component(component_name) };
+
+        if (!opt || (!has_tod && *opt >= Component::hour))
+            cpp11::stop("Invalid component: (%s)", component_name.c_str());
+
+        out.push_back(*opt);
+    }
+
+    return out;
+}
+
+static
+cpp11::writable::list
+alloc_components(const std::vector<Component>& which, const cpp11::strings& components,
+                 const R_xlen_t size, std::vector<int*>& cols)
+{
+    cpp11::writable::list out(which.size());
+    cols.resize(which.size());
+
+    for (std::size_t j = 0; j < which.size(); ++j)
     {
-        if (std::isnan(xx[i]))
+        if (which[j] == Component::leap_year)
         {
-            out[i] = NA_INTEGER;
-            continue;
+            cpp11::writable::logicals col(size);
+            cols[j] = LOGICAL(col);
+            out[j] = col;
+        }
+        else
+        {
+            cpp11::writable::integers col(size);
+            cols[j] = INTEGER(col);
+            out[j] = col;
         }
-
-        ld = date::local_days{ date::days(static_cast<int>(xx[i])) };
-        out[i] = sh_wday(ld).count();
     }
 
+    out.names() = components;
     return out;
 }
 
 [[cpp11::register]]
-cpp11::writable::integers
-jdate_get_qday_cpp(const cpp11::sexp x)
+cpp11::writable::list
+jdate_components_cpp(const cpp11::sexp x, const cpp11::strings& components)
+{
+    const auto which = parse_components(components, false);
+    const std::size_t n_components = which.size();
+    const R_xlen_t size = Rf_xlength(x);
+    std::vector<int*> cols;
+    cpp11::writable::list out = alloc_components(which, components, size, cols);
+    sh_ymd_cursor cursor;
+
+    visit_days(x, [&](const auto* xx) {
+        for (R_xlen_t i = 0; i < size; ++i)
+        {
+            if (!detail::days_ok(xx[i]))
+            {
+                for (std::size_t j = 0; j < n_components; ++j)
+                    cols[j][i] = NA_INTEGER;
+                continue;
+            }
+
+            const int jd{ detail::days_to_jd(xx[i], true) };
+            const auto p = cursor(jd);
+
+            for (std::size_t j = 0; j < n_components; ++j)
+                cols[j][i] = component_value(which[j], p, jd, 0);
+        }
+    });
+
+    return out;
+}
+
+[[cpp11::register]]
+cpp11::writable::list
+jdatetime_components_cpp(const cpp11::sexp x, const cpp11::strings& components)
 {
+    const auto which = parse_components(components, true);
+    const std::size_t n_components = which.size();
     const cpp11::doubles xx = cpp11::as_cpp<cpp11::doubles>(x);
+    const cpp11::strings tz_name_ =  cpp11::as_cpp<cpp11::strings>(x.attr("tzone"));
+    std::string tz_name(tz_name_[0]);
+
+    if (!tz_name.size())
+    {
+        tz_name = get_current_tzone_cpp();
+    }
+
+    const zone_table* table{ locate_zone_table(tz_name) };
+    if (!table)
+    {
+        cpp11::stop(std::string(tz_name + " not found in timezone database").c_str());
+    }
+
     const R_xlen_t size = xx.size();
-    cpp11::writable::integers out(size);
+    std::vector<int*> cols;
+    cpp11::writable::list out = alloc_components(which, components, size, cols);
+    date::local_seconds ls;
+    date::local_days ld;
+    sys_info_cursor tz_cursor(*table, REAL(xx), xx.size());
+    sh_ymd_cursor cursor;
+    int jd{};
 
     for (R_xlen_t i = 0; i < size; ++i)
     {
-        if (std::isnan(xx[i]))
+        if (i > 0 && xx[i] == xx[i - 1])
+        {
+            for (std::size_t j = 0; j < n_components; ++j)
+                cols[j][i] = cols[j][i - 1];
+            continue;
+        }
+
+        if (!std::isnan(xx[i]))
+        {
+            ls = to_local_seconds(sys_seconds_from_double(xx[i]), tz_cursor);
+            ld = date::floor<date::days>(ls);
+            jd = static_cast<int>(ld.time_since_epoch().count()) + internal::JD_UNIX_EPOCH;
+        }
+
+        if (std::isnan(xx[i]) || !detail::jd_in_range(jd))
         {
-            out[i] = NA_INTEGER;
+            for (std::size_t j = 0; j < n_components; ++j)
+                cols[j][i] = NA_INTEGER;
             continue;
         }
 
-        auto ymd = sh_year_month_day{ date::local_days{ date::days(static_cast<int>(xx[i])) } };
-        out[i] = sh_qday(ymd).count();
+        const auto p = cursor(jd);
+        const int tod{ static_cast<int>((ls - ld).count()) };
+
+        for (std::size_t j = 0; j < n_components; ++j)
+            cols[j][i] = component_value(which[j], p, jd, tod);
     }
 
     return out;
@@ -0,0 +1,313 @@
+#include "shide.h"
+#include <shide/seq.h>
+#include <R_ext/Altrep.h>
+#include <R_ext/Rdynload.h>
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+// ALTREP classes for the sequences made by seq.jdate() and seq.jdatetime(). A compact sequence
+// keeps only its parameters, in a double vector stored as data1, and computes its elements from
+// their indices when they are used. Sums, minima, maxima and sortedness are answered from the
+// parameters. Once R asks for a pointer to the data, the elements are written to a vector
+// stored as data2, which is used from then on, as it may be modified.
+
+namespace
+{
+    // The sequence `from + k * by`, for the days of a `jdate` or the seconds of a `jdatetime`.
+    // Its parameters are whole numbers, so elements and sums are exact.
+    class arith_seq
+    {
+        double from_;
+        double by_;
+        R_xlen_t size_;
+
+    public:
+        static constexpr const char* class_name{ "shide_arith_seq" };
+        static constexpr int state_size{ 3 };
+
+        explicit arith_seq(const double* state)
+            : from_{ state[0] }, by_{ state[1] }, size_{ static_cast<R_xlen_t>(state[2]) }
+        {}
+
+        R_xlen_t size() const { return size_; }
+
+        double operator()(const R_xlen_t k) const { return from_ + static_cast<double>(k) * by_; }
+
+        bool no_na() const { return true; }
+
+        int sortedness() const { return by_ < 0 ? SORTED_DECR : SORTED_INCR; }
+
+        double sum(const bool) const
+        {
+            const long double n{ static_cast<long double>(size_) };
+            return static_cast<double>(n * from_ + by_ * (n * (n - 1) / 2));
+        }
+
+        void print() const
+        {
+            Rprintf(" from = %.0f, by = %.0f, size = %.0f\n", from_, by_,
+                    static_cast<double>(size_));
+        }
+    };
+
+    // A jdate_calendar_seq of days, which are NA beyond the calendar. Such elements can only be at
+    // the end, as the sequence is monotone.
+    class calendar_seq
+    {
+        jdate_calendar_seq seq_;
+        int from_;
+        int n_;
+        bool years_;
+        R_xlen_t size_;
+
+    public:
+        static constexpr const char* class_name{ "shide_calendar_seq" };
+        static constexpr int state_size{ 4 };
+
+        explicit calendar_seq(const double* state)
+            : seq_{ static_cast<int>(state[0]), static_cast<int>(state[1]), state[2] != 0 },
+              from_{ static_cast<int>(state[0]) }, n_{ static_cast<int>(state[1]) },
+              years_{ state[2] != 0 }, size_{ static_cast<R_xlen_t>(state[3]) }
+        {}
+
+        R_xlen_t size() const { return size_; }
+
+        double operator()(const R_xlen_t k) const
+        {
+            const auto d = seq_(k);
+            return d ? static_cast<double>(*d) : NA_REAL;
+        }
+
+        bool no_na() const { return !std::isnan((*this)(size_ - 1)); }
+
+        int sortedness() const
+        {
+            if (!no_na())
+                return UNKNOWN_SORTEDNESS;
+
+            return n_ < 0 ? SORTED_DECR : SORTED_INCR;
+        }
+
+        double sum(const bool na_rm) const
+        {
+            long double out{ 0 };
+            for (R_xlen_t k = 0; k < size_; ++k)
+            {
+                const double x{ (*this)(k) };
+                if (std::isnan(x))
+                {
+                    if (!na_rm)
+                        return NA_REAL;
+                    // the rest is beyond the calendar too
+                    break;
+                }
+
+                out += x;
+            }
+
+            return static_cast<double>(out);
+        }
+
+        void print() const
+        {
+            Rprintf(" from = %d, by = %d %s, size = %.0f\n", from_, n_,
+                    years_ ? "years" : "months", static_cast<double>(size_));
+        }
+    };
+
+    template <class Seq>
+    class compact_seq
+    {
+        static inline R_altrep_class_t class_t;
+
+        static Seq seq(const SEXP x) { return Seq{ REAL(R_altrep_data1(x)) }; }
+
+        static bool expanded(const SEXP x) { return R_altrep_data2(x) != R_NilValue; }
+
+        static R_xlen_t Length(const SEXP x)
+        {
+            return expanded(x) ? XLENGTH(R_altrep_data2(x)) : seq(x).size();
+        }
+
+        static Rboolean Inspect(const SEXP x, int, int, int, void (*)(SEXP, int, int, int))
+        {
+            Rprintf("%s%s", Seq::class_name, expanded(x) ? " (expanded)" : "");
+            seq(x).print();
+            return TRUE;
+        }
+
+        static SEXP Duplicate(const SEXP x, Rboolean)
+        {
+            // the parameters are never modified, so they can be shared
+            return expanded(x) ? nullptr : R_new_altrep(class_t, R_altrep_data1(x), R_NilValue);
+        }
+
+        static SEXP Serialized_state(const SEXP x)
+        {
+            return expanded(x) ? nullptr : R_altrep_data1(x);
+        }
+
+        static SEXP Unserialize(SEXP, const SEXP state)
+        {
+            return R_new_altrep(class_t, state, R_NilValue);
+        }
+
+        static void* Dataptr(const SEXP x, Rboolean)
+        {
+            if (!expanded(x))
+            {
+                const Seq s{ seq(x) };
+                const SEXP data = PROTECT(Rf_allocVector(REALSXP, s.size()));
+                double* p = REAL(data);
+                for (R_xlen_t k = 0; k < s.size(); ++k)
+                    p[k] = s(k);
+
+                R_set_altrep_data2(x, data);
+                UNPROTECT(1);
+            }
+
+            return REAL(R_altrep_data2(x));
+        }
+
+        static const void* Dataptr_or_null(const SEXP x)
+        {
+            return expanded(x) ? REAL(R_altrep_data2(x)) : nullptr;
+        }
+
+        static double Elt(const SEXP x, const R_xlen_t i)
+        {
+            return expanded(x) ? REAL_ELT(R_altrep_data2(x), i) : seq(x)(i);
+        }
+
+        static R_xlen_t Get_region(const SEXP x, const R_xlen_t i, const R_xlen_t n, double* buf)
+        {
+            if (expanded(x))
+                return REAL_GET_REGION(R_altrep_data2(x), i, n, buf);
+
+            const Seq s{ seq(x) };
+            const R_xlen_t m{ std::min(n, s.size() - i) };
+            for (R_xlen_t k = 0; k < m; ++k)
+                buf[k] = s(i + k);
+
+            return m;
+        }
+
+        // the elements at the 1-based positions `indx`, as R's `[` takes them; positions past the
+        // end and NA give NA
+        static SEXP Extract_subset(const SEXP x, const SEXP indx, SEXP)
+        {
+            if (expanded(x) || (TYPEOF(indx) != INTSXP && TYPEOF(indx) != REALSXP))
+                return nullptr;
+
+            const Seq s{ seq(x) };
+            const R_xlen_t size{ XLENGTH(indx) };
+            const SEXP out = PROTECT(Rf_allocVector(REALSXP, size));
+            double* p = REAL(out);
+
+            for (R_xlen_t j = 0; j < size; ++j)
+            {
+                double k;
+                if (TYPEOF(indx) == INTSXP)
+                    k = INTEGER_ELT(indx, j) == NA_INTEGER ? NA_REAL : INTEGER_ELT(indx, j);
+                else
+                    k = REAL_ELT(indx, j);
+
+                p[j] = std::isnan(k) || k < 1 || k > static_cast<double>(s.size()) ?
+                    NA_REAL : s(static_cast<R_xlen_t>(k) - 1);
+            }
+
+            UNPROTECT(1);
+            return out;
+        }
+
+        static int Is_sorted(const SEXP x)
+        {
+            return expanded(x) ? UNKNOWN_SORTEDNESS : seq(x).sortedness();
+        }
+
+        static int No_NA(const SEXP x)
+        {
+            return !expanded(x) && seq(x).no_na();
+        }
+
+        static SEXP Sum(const SEXP x, const Rboolean na_rm)
+        {
+            return expanded(x) ? nullptr : Rf_ScalarReal(seq(x).sum(na_rm));
+        }
+
+        // the first or the last element, which are the extremes of a monotone sequence
+        static SEXP extreme(const SEXP x, const bool min)
+        {
+            if (expanded(x))
+                return nullptr;
+
+            const Seq s{ seq(x) };
+            if (!s.no_na())
+                return nullptr;
+
+            const bool first{ (s.sortedness() == SORTED_INCR) == min };
+            return Rf_ScalarReal(s(first ? 0 : s.size() - 1));
+        }
+
+        static SEXP Min(const SEXP x, Rboolean) { return extreme(x, true); }
+
+        static SEXP Max(const SEXP x, Rboolean) { return extreme(x, false); }
+
+    public:
+        static void init(DllInfo* dll)
+        {
+            class_t = R_make_altreal_class(Seq::class_name, "shide", dll);
+
+            R_set_altrep_Length_method(class_t, Length);
+            R_set_altrep_Inspect_method(class_t, Inspect);
+            R_set_altrep_Duplicate_method(class_t, Duplicate);
+            R_set_altrep_Serialized_state_method(class_t, Serialized_state);
+            R_set_altrep_Unserialize_method(class_t, Unserialize);
+
+            R_set_altvec_Dataptr_method(class_t, Dataptr);
+            R_set_altvec_Dataptr_or_null_method(class_t, Dataptr_or_null);
+            R_set_altvec_Extract_subset_method(class_t, Extract_subset);
+
+            R_set_altreal_Elt_method(class_t, Elt);
+            R_set_altreal_Get_region_method(class_t, Get_region);
+            R_set_altreal_Is_sorted_method(class_t, Is_sorted);
+            R_set_altreal_No_NA_method(class_t, No_NA);
+            R_set_altreal_Sum_method(class_t, Sum);
+            R_set_altreal_Min_method(class_t, Min);
+            R_set_altreal_Max_method(class_t, Max);
+        }
+
+        // a compact sequence with the parameters `state`
+        static SEXP make(const std::array<double, Seq::state_size>& state)
+        {
+            const SEXP data1 = PROTECT(Rf_allocVector(REALSXP, Seq::state_size));
+            std::copy(state.begin(), state.end(), REAL(data1));
+            const SEXP out = R_new_altrep(class_t, data1, R_NilValue);
+            UNPROTECT(1);
+            return out;
+        }
+    };
+}
+
+SEXP
+new_arith_seq(const double from, const double by, const R_xlen_t size)
+{
+    return compact_seq<arith_seq>::make({ from, by, static_cast<double>(size) });
+}
+
+SEXP
+new_calendar_seq(const int from, const int n, const bool years, const R_xlen_t size)
+{
+    return compact_seq<calendar_seq>::make(
+        { static_cast<double>(from), static_cast<double>(n), years ? 1.0 : 0.0,
+          static_cast<double>(size) });
+}
+
+[[cpp11::init]]
+void
+init_compact_seq(DllInfo* dll)
+{
+    compact_seq<arith_seq>::init(dll);
+    compact_seq<calendar_seq>::init(dll);
+}
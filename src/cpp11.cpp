@@ -40,18 +40,32 @@ extern "C" SEXP _shide_jdate_get_qday_cpp(SEXP x) {
     return cpp11::as_sexp(jdate_get_qday_cpp(cpp11::as_cpp<cpp11::decay_t<const cpp11::sexp>>(x)));
   END_CPP11
 }
+// accessors.cpp
+cpp11::writable::list jdate_components_cpp(const cpp11::sexp x, const cpp11::strings& components);
+extern "C" SEXP _shide_jdate_components_cpp(SEXP x, SEXP components) {
+  BEGIN_CPP11
+    return cpp11::as_sexp(jdate_components_cpp(cpp11::as_cpp<cpp11::decay_t<const cpp11::sexp>>(x), cpp11::as_cpp<cpp11::decay_t<const cpp11::strings&>>(components)));
+  END_CPP11
+}
+// accessors.cpp
+cpp11::writable::list jdatetime_components_cpp(const cpp11::sexp x, const cpp11::strings& components);
+extern "C" SEXP _shide_jdatetime_components_cpp(SEXP x, SEXP components) {
+  BEGIN_CPP11
+    return cpp11::as_sexp(jdatetime_components_cpp(cpp11::as_cpp<cpp11::decay_t<const cpp11::sexp>>(x), cpp11::as_cpp<cpp11::decay_t<const cpp11::strings&>>(components)));
+  END_CPP11
+}
 // format.cpp
-cpp11::writable::strings format_jdate_cpp(const cpp11::doubles x, const cpp11::strings& format);
-extern "C" SEXP _shide_format_jdate_cpp(SEXP x, SEXP format) {
+cpp11::writable::strings format_jdate_cpp(const cpp11::sexp x, const cpp11::strings& format, const std::string& names, const std::string& numerals, const int n_threads);
+extern "C" SEXP _shide_format_jdate_cpp(SEXP x, SEXP format, SEXP names, SEXP numerals, SEXP n_threads) {
   BEGIN_CPP11
-    return cpp11::as_sexp(format_jdate_cpp(cpp11::as_cpp<cpp11::decay_t<const cpp11::doubles>>(x), cpp11::as_cpp<cpp11::decay_t<const cpp11::strings&>>(format)));
+    return cpp11::as_sexp(format_jdate_cpp(cpp11::as_cpp<cpp11::decay_t<const cpp11::sexp>>(x), cpp11::as_cpp<cpp11::decay_t<const cpp11::strings&>>(format), cpp11::as_cpp<cpp11::decay_t<const std::string&>>(names), cpp11::as_cpp<cpp11::decay_t<const std::string&>>(numerals), cpp11::as_cpp<cpp11::decay_t<const int>>(n_threads)));
   END_CPP11
 }
 // format.cpp
-cpp11::writable::strings format_jdatetime_cpp(const cpp11::sexp x, const cpp11::strings& format);
-extern "C" SEXP _shide_format_jdatetime_cpp(SEXP x, SEXP format) {
+cpp11::writable::strings format_jdatetime_cpp(const cpp11::sexp x, const cpp11::strings& format, const std::string& names, const std::string& numerals, const int n_threads);
+extern "C" SEXP _shide_format_jdatetime_cpp(SEXP x, SEXP format, SEXP names, SEXP numerals, SEXP n_threads) {
   BEGIN_CPP11
-    return cpp11::as_sexp(format_jdatetime_cpp(cpp11::as_cpp<cpp11::decay_t<const cpp11::sexp>>(x), cpp11::as_cpp<cpp11::decay_t<const cpp11::strings&>>(format)));
+    return cpp11::as_sexp(format_jdatetime_cpp(cpp11::as_cpp<cpp11::decay_t<const cpp11::sexp>>(x), cpp11::as_cpp<cpp11::decay_t<const cpp11::strings&>>(format), cpp11::as_cpp<cpp11::decay_t<const std::string&>>(names), cpp11::as_cpp<cpp11::decay_t<const std::string&>>(numerals), cpp11::as_cpp<cpp11::decay_t<const int>>(n_threads)));
   END_CPP11
 }
 // leap_years.cpp
@@ -61,6 +75,20 @@ extern "C" SEXP _shide_year_is_leap_cpp(SEXP x) {
     return cpp11::as_sexp(year_is_leap_cpp(cpp11::as_cpp<cpp11::decay_t<const cpp11::integers&>>(x)));
   END_CPP11
 }
+// leap_years.cpp
+cpp11::writable::integers days_in_year_cpp(const cpp11::integers& x);
+extern "C" SEXP _shide_days_in_year_cpp(SEXP x) {
+  BEGIN_CPP11
+    return cpp11::as_sexp(days_in_year_cpp(cpp11::as_cpp<cpp11::decay_t<const cpp11::integers&>>(x)));
+  END_CPP11
+}
+// leap_years.cpp
+cpp11::writable::integers days_in_month_cpp(const cpp11::integers& year, const cpp11::integers& month);
+extern "C" SEXP _shide_days_in_month_cpp(SEXP year, SEXP month) {
+  BEGIN_CPP11
+    return cpp11::as_sexp(days_in_month_cpp(cpp11::as_cpp<cpp11::decay_t<const cpp11::integers&>>(year), cpp11::as_cpp<cpp11::decay_t<const cpp11::integers&>>(month)));
+  END_CPP11
+}
 // make.cpp
 doubles jdate_make_cpp(cpp11::list_of<cpp11::integers> fields);
 extern "C" SEXP _shide_jdate_make_cpp(SEXP fields) {
@@ -83,34 +111,41 @@ extern "C" SEXP _shide_jdatetime_make_with_reference_cpp(SEXP fields, SEXP tzone
   END_CPP11
 }
 // parse.cpp
-cpp11::writable::doubles jdate_parse_cpp(const cpp11::strings& x, const cpp11::strings& format);
-extern "C" SEXP _shide_jdate_parse_cpp(SEXP x, SEXP format) {
+cpp11::writable::doubles jdate_parse_cpp(const cpp11::strings& x, const cpp11::strings& format, const cpp11::strings& lenient, const int n_threads);
+extern "C" SEXP _shide_jdate_parse_cpp(SEXP x, SEXP format, SEXP lenient, SEXP n_threads) {
   BEGIN_CPP11
-    return cpp11::as_sexp(jdate_parse_cpp(cpp11::as_cpp<cpp11::decay_t<const cpp11::strings&>>(x), cpp11::as_cpp<cpp11::decay_t<const cpp11::strings&>>(format)));
+    return cpp11::as_sexp(jdate_parse_cpp(cpp11::as_cpp<cpp11::decay_t<const cpp11::strings&>>(x), cpp11::as_cpp<cpp11::decay_t<const cpp11::strings&>>(format), cpp11::as_cpp<cpp11::decay_t<const cpp11::strings&>>(lenient), cpp11::as_cpp<cpp11::decay_t<const int>>(n_threads)));
   END_CPP11
 }
 // parse.cpp
-cpp11::writable::doubles jdatetime_parse_cpp(const cpp11::strings& x, const cpp11::strings& format, const cpp11::strings& tzone, const std::string& ambiguous);
-extern "C" SEXP _shide_jdatetime_parse_cpp(SEXP x, SEXP format, SEXP tzone, SEXP ambiguous) {
+cpp11::writable::doubles jdatetime_parse_cpp(const cpp11::strings& x, const cpp11::strings& format, const cpp11::strings& lenient, const cpp11::strings& tzone, const std::string& ambiguous, const int n_threads);
+extern "C" SEXP _shide_jdatetime_parse_cpp(SEXP x, SEXP format, SEXP lenient, SEXP tzone, SEXP ambiguous, SEXP n_threads) {
   BEGIN_CPP11
-    return cpp11::as_sexp(jdatetime_parse_cpp(cpp11::as_cpp<cpp11::decay_t<const cpp11::strings&>>(x), cpp11::as_cpp<cpp11::decay_t<const cpp11::strings&>>(format), cpp11::as_cpp<cpp11::decay_t<const cpp11::strings&>>(tzone), cpp11::as_cpp<cpp11::decay_t<const std::string&>>(ambiguous)));
+    return cpp11::as_sexp(jdatetime_parse_cpp(cpp11::as_cpp<cpp11::decay_t<const cpp11::strings&>>(x), cpp11::as_cpp<cpp11::decay_t<const cpp11::strings&>>(format), cpp11::as_cpp<cpp11::decay_t<const cpp11::strings&>>(lenient), cpp11::as_cpp<cpp11::decay_t<const cpp11::strings&>>(tzone), cpp11::as_cpp<cpp11::decay_t<const std::string&>>(ambiguous), cpp11::as_cpp<cpp11::decay_t<const int>>(n_threads)));
   END_CPP11
 }
 // round.cpp
-cpp11::writable::doubles jdate_ceiling_cpp(const cpp11::sexp x, const std::string& unit_name, const int n);
+cpp11::sexp jdate_ceiling_cpp(const cpp11::sexp x, const std::string& unit_name, const int n);
 extern "C" SEXP _shide_jdate_ceiling_cpp(SEXP x, SEXP unit_name, SEXP n) {
   BEGIN_CPP11
     return cpp11::as_sexp(jdate_ceiling_cpp(cpp11::as_cpp<cpp11::decay_t<const cpp11::sexp>>(x), cpp11::as_cpp<cpp11::decay_t<const std::string&>>(unit_name), cpp11::as_cpp<cpp11::decay_t<const int>>(n)));
   END_CPP11
 }
 // round.cpp
-cpp11::writable::doubles jdate_floor_cpp(const cpp11::sexp x, const std::string& unit_name, const int n);
+cpp11::sexp jdate_floor_cpp(const cpp11::sexp x, const std::string& unit_name, const int n);
 extern "C" SEXP _shide_jdate_floor_cpp(SEXP x, SEXP unit_name, SEXP n) {
   BEGIN_CPP11
     return cpp11::as_sexp(jdate_floor_cpp(cpp11::as_cpp<cpp11::decay_t<const cpp11::sexp>>(x), cpp11::as_cpp<cpp11::decay_t<const std::string&>>(unit_name), cpp11::as_cpp<cpp11::decay_t<const int>>(n)));
   END_CPP11
 }
 // round.cpp
+cpp11::sexp jdate_round_cpp(const cpp11::sexp x, const std::string& unit_name, const int n);
+extern "C" SEXP _shide_jdate_round_cpp(SEXP x, SEXP unit_name, SEXP n) {
+  BEGIN_CPP11
+    return cpp11::as_sexp(jdate_round_cpp(cpp11::as_cpp<cpp11::decay_t<const cpp11::sexp>>(x), cpp11::as_cpp<cpp11::decay_t<const std::string&>>(unit_name), cpp11::as_cpp<cpp11::decay_t<const int>>(n)));
+  END_CPP11
+}
+// round.cpp
 cpp11::writable::doubles jdatetime_floor_cpp(const cpp11::sexp x, const std::string& unit_name, const int n);
 extern "C" SEXP _shide_jdatetime_floor_cpp(SEXP x, SEXP unit_name, SEXP n) {
   BEGIN_CPP11
@@ -125,6 +160,27 @@ extern "C" SEXP _shide_jdatetime_ceiling_cpp(SEXP x, SEXP unit_name, SEXP n) {
   END_CPP11
 }
 // round.cpp
+cpp11::writable::doubles jdatetime_round_cpp(const cpp11::sexp x, const std::string& unit_name, const int n);
+extern "C" SEXP _shide_jdatetime_round_cpp(SEXP x, SEXP unit_name, SEXP n) {
+  BEGIN_CPP11
+    return cpp11::as_sexp(jdatetime_round_cpp(cpp11::as_cpp<cpp11::decay_t<const cpp11::sexp>>(x), cpp11::as_cpp<cpp11::decay_t<const std::string&>>(unit_name), cpp11::as_cpp<cpp11::decay_t<const int>>(n)));
+  END_CPP11
+}
+// round.cpp
+cpp11::writable::list jdate_bucket_cpp(const cpp11::sexp x, const std::string& unit_name, const int n);
+extern "C" SEXP _shide_jdate_bucket_cpp(SEXP x, SEXP unit_name, SEXP n) {
+  BEGIN_CPP11
+    return cpp11::as_sexp(jdate_bucket_cpp(cpp11::as_cpp<cpp11::decay_t<const cpp11::sexp>>(x), cpp11::as_cpp<cpp11::decay_t<const std::string&>>(unit_name), cpp11::as_cpp<cpp11::decay_t<const int>>(n)));
+  END_CPP11
+}
+// round.cpp
+cpp11::writable::list jdatetime_bucket_cpp(const cpp11::sexp x, const std::string& unit_name, const int n);
+extern "C" SEXP _shide_jdatetime_bucket_cpp(SEXP x, SEXP unit_name, SEXP n) {
+  BEGIN_CPP11
+    return cpp11::as_sexp(jdatetime_bucket_cpp(cpp11::as_cpp<cpp11::decay_t<const cpp11::sexp>>(x), cpp11::as_cpp<cpp11::decay_t<const std::string&>>(unit_name), cpp11::as_cpp<cpp11::decay_t<const int>>(n)));
+  END_CPP11
+}
+// round.cpp
 cpp11::writable::list parse_unit_cpp(const cpp11::strings& unit);
 extern "C" SEXP _shide_parse_unit_cpp(SEXP unit) {
   BEGIN_CPP11
@@ -132,24 +188,31 @@ extern "C" SEXP _shide_parse_unit_cpp(SEXP unit) {
   END_CPP11
 }
 // seq.cpp
-cpp11::writable::doubles jdate_seq_by_month_cpp(const cpp11::sexp& x, const cpp11::integers& dm);
-extern "C" SEXP _shide_jdate_seq_by_month_cpp(SEXP x, SEXP dm) {
+cpp11::sexp seq_compact_cpp(const cpp11::sexp from, const cpp11::sexp to, const cpp11::sexp length_out, const double by);
+extern "C" SEXP _shide_seq_compact_cpp(SEXP from, SEXP to, SEXP length_out, SEXP by) {
+  BEGIN_CPP11
+    return cpp11::as_sexp(seq_compact_cpp(cpp11::as_cpp<cpp11::decay_t<const cpp11::sexp>>(from), cpp11::as_cpp<cpp11::decay_t<const cpp11::sexp>>(to), cpp11::as_cpp<cpp11::decay_t<const cpp11::sexp>>(length_out), cpp11::as_cpp<cpp11::decay_t<const double>>(by)));
+  END_CPP11
+}
+// seq.cpp
+cpp11::sexp jdate_seq_by_cpp(const cpp11::sexp from, const cpp11::sexp to, const cpp11::sexp length_out, const std::string& unit_name, const int n);
+extern "C" SEXP _shide_jdate_seq_by_cpp(SEXP from, SEXP to, SEXP length_out, SEXP unit_name, SEXP n) {
   BEGIN_CPP11
-    return cpp11::as_sexp(jdate_seq_by_month_cpp(cpp11::as_cpp<cpp11::decay_t<const cpp11::sexp&>>(x), cpp11::as_cpp<cpp11::decay_t<const cpp11::integers&>>(dm)));
+    return cpp11::as_sexp(jdate_seq_by_cpp(cpp11::as_cpp<cpp11::decay_t<const cpp11::sexp>>(from), cpp11::as_cpp<cpp11::decay_t<const cpp11::sexp>>(to), cpp11::as_cpp<cpp11::decay_t<const cpp11::sexp>>(length_out), cpp11::as_cpp<cpp11::decay_t<const std::string&>>(unit_name), cpp11::as_cpp<cpp11::decay_t<const int>>(n)));
   END_CPP11
 }
 // seq.cpp
-cpp11::writable::doubles jdate_seq_by_year_cpp(const cpp11::sexp& x, const cpp11::integers& dy);
-extern "C" SEXP _shide_jdate_seq_by_year_cpp(SEXP x, SEXP dy) {
+cpp11::writable::doubles jdatetime_seq_by_cpp(const cpp11::sexp from, const cpp11::sexp to, const cpp11::sexp length_out, const std::string& unit_name, const int n, const cpp11::strings& tzone);
+extern "C" SEXP _shide_jdatetime_seq_by_cpp(SEXP from, SEXP to, SEXP length_out, SEXP unit_name, SEXP n, SEXP tzone) {
   BEGIN_CPP11
-    return cpp11::as_sexp(jdate_seq_by_year_cpp(cpp11::as_cpp<cpp11::decay_t<const cpp11::sexp&>>(x), cpp11::as_cpp<cpp11::decay_t<const cpp11::integers&>>(dy)));
+    return cpp11::as_sexp(jdatetime_seq_by_cpp(cpp11::as_cpp<cpp11::decay_t<const cpp11::sexp>>(from), cpp11::as_cpp<cpp11::decay_t<const cpp11::sexp>>(to), cpp11::as_cpp<cpp11::decay_t<const cpp11::sexp>>(length_out), cpp11::as_cpp<cpp11::decay_t<const std::string&>>(unit_name), cpp11::as_cpp<cpp11::decay_t<const int>>(n), cpp11::as_cpp<cpp11::decay_t<const cpp11::strings&>>(tzone)));
   END_CPP11
 }
 // utils.cpp
-cpp11::writable::doubles sys_seconds_from_local_days_cpp(const cpp11::doubles x, const cpp11::strings& tzone);
+cpp11::writable::doubles sys_seconds_from_local_days_cpp(const cpp11::sexp x, const cpp11::strings& tzone);
 extern "C" SEXP _shide_sys_seconds_from_local_days_cpp(SEXP x, SEXP tzone) {
   BEGIN_CPP11
-    return cpp11::as_sexp(sys_seconds_from_local_days_cpp(cpp11::as_cpp<cpp11::decay_t<const cpp11::doubles>>(x), cpp11::as_cpp<cpp11::decay_t<const cpp11::strings&>>(tzone)));
+    return cpp11::as_sexp(sys_seconds_from_local_days_cpp(cpp11::as_cpp<cpp11::decay_t<const cpp11::sexp>>(x), cpp11::as_cpp<cpp11::decay_t<const cpp11::strings&>>(tzone)));
   END_CPP11
 }
 // utils.cpp
@@ -159,6 +222,13 @@ extern "C" SEXP _shide_local_days_from_sys_seconds_cpp(SEXP x, SEXP tzone) {
     return cpp11::as_sexp(local_days_from_sys_seconds_cpp(cpp11::as_cpp<cpp11::decay_t<const cpp11::doubles>>(x), cpp11::as_cpp<cpp11::decay_t<const cpp11::strings&>>(tzone)));
   END_CPP11
 }
+// utils.cpp
+std::string get_current_tzone_cpp();
+extern "C" SEXP _shide_get_current_tzone_cpp() {
+  BEGIN_CPP11
+    return cpp11::as_sexp(get_current_tzone_cpp());
+  END_CPP11
+}
 // zone.cpp
 cpp11::writable::list get_local_info_cpp(const cpp11::strings& x, const cpp11::strings& tzone);
 extern "C" SEXP _shide_get_local_info_cpp(SEXP x, SEXP tzone) {
@@ -176,36 +246,48 @@ extern "C" SEXP _shide_get_sys_info_cpp(SEXP x) {
 
 extern "C" {
 static const R_CallMethodDef CallEntries[] = {
-    {"_shide_format_jdate_cpp",                  (DL_FUNC) &_shide_format_jdate_cpp,                  2},
-    {"_shide_format_jdatetime_cpp",              (DL_FUNC) &_shide_format_jdatetime_cpp,              2},
+    {"_shide_days_in_month_cpp",                 (DL_FUNC) &_shide_days_in_month_cpp,                 2},
+    {"_shide_days_in_year_cpp",                  (DL_FUNC) &_shide_days_in_year_cpp,                  1},
+    {"_shide_format_jdate_cpp",                  (DL_FUNC) &_shide_format_jdate_cpp,                  5},
+    {"_shide_format_jdatetime_cpp",              (DL_FUNC) &_shide_format_jdatetime_cpp,              5},
+    {"_shide_get_current_tzone_cpp",             (DL_FUNC) &_shide_get_current_tzone_cpp,             0},
     {"_shide_get_local_info_cpp",                (DL_FUNC) &_shide_get_local_info_cpp,                2},
     {"_shide_get_sys_info_cpp",                  (DL_FUNC) &_shide_get_sys_info_cpp,                  1},
+    {"_shide_jdate_bucket_cpp",                  (DL_FUNC) &_shide_jdate_bucket_cpp,                  3},
     {"_shide_jdate_ceiling_cpp",                 (DL_FUNC) &_shide_jdate_ceiling_cpp,                 3},
+    {"_shide_jdate_components_cpp",              (DL_FUNC) &_shide_jdate_components_cpp,              2},
     {"_shide_jdate_floor_cpp",                   (DL_FUNC) &_shide_jdate_floor_cpp,                   3},
     {"_shide_jdate_get_fields_cpp",              (DL_FUNC) &_shide_jdate_get_fields_cpp,              1},
     {"_shide_jdate_get_qday_cpp",                (DL_FUNC) &_shide_jdate_get_qday_cpp,                1},
     {"_shide_jdate_get_wday_cpp",                (DL_FUNC) &_shide_jdate_get_wday_cpp,                1},
     {"_shide_jdate_get_yday_cpp",                (DL_FUNC) &_shide_jdate_get_yday_cpp,                1},
     {"_shide_jdate_make_cpp",                    (DL_FUNC) &_shide_jdate_make_cpp,                    1},
-    {"_shide_jdate_parse_cpp",                   (DL_FUNC) &_shide_jdate_parse_cpp,                   2},
-    {"_shide_jdate_seq_by_month_cpp",            (DL_FUNC) &_shide_jdate_seq_by_month_cpp,            2},
-    {"_shide_jdate_seq_by_year_cpp",             (DL_FUNC) &_shide_jdate_seq_by_year_cpp,             2},
+    {"_shide_jdate_parse_cpp",                   (DL_FUNC) &_shide_jdate_parse_cpp,                   4},
+    {"_shide_jdate_round_cpp",                   (DL_FUNC) &_shide_jdate_round_cpp,                   3},
+    {"_shide_jdate_seq_by_cpp",                  (DL_FUNC) &_shide_jdate_seq_by_cpp,                  5},
+    {"_shide_jdatetime_bucket_cpp",              (DL_FUNC) &_shide_jdatetime_bucket_cpp,              3},
     {"_shide_jdatetime_ceiling_cpp",             (DL_FUNC) &_shide_jdatetime_ceiling_cpp,             3},
+    {"_shide_jdatetime_components_cpp",          (DL_FUNC) &_shide_jdatetime_components_cpp,          2},
     {"_shide_jdatetime_floor_cpp",               (DL_FUNC) &_shide_jdatetime_floor_cpp,               3},
     {"_shide_jdatetime_get_fields_cpp",          (DL_FUNC) &_shide_jdatetime_get_fields_cpp,          1},
     {"_shide_jdatetime_make_cpp",                (DL_FUNC) &_shide_jdatetime_make_cpp,                3},
     {"_shide_jdatetime_make_with_reference_cpp", (DL_FUNC) &_shide_jdatetime_make_with_reference_cpp, 3},
-    {"_shide_jdatetime_parse_cpp",               (DL_FUNC) &_shide_jdatetime_parse_cpp,               4},
+    {"_shide_jdatetime_parse_cpp",               (DL_FUNC) &_shide_jdatetime_parse_cpp,               6},
+    {"_shide_jdatetime_round_cpp",               (DL_FUNC) &_shide_jdatetime_round_cpp,               3},
+    {"_shide_jdatetime_seq_by_cpp",              (DL_FUNC) &_shide_jdatetime_seq_by_cpp,              6},
     {"_shide_local_days_from_sys_seconds_cpp",   (DL_FUNC) &_shide_local_days_from_sys_seconds_cpp,   2},
     {"_shide_parse_unit_cpp",                    (DL_FUNC) &_shide_parse_unit_cpp,                    1},
+    {"_shide_seq_compact_cpp",                   (DL_FUNC) &_shide_seq_compact_cpp,                   4},
     {"_shide_sys_seconds_from_local_days_cpp",   (DL_FUNC) &_shide_sys_seconds_from_local_days_cpp,   2},
     {"_shide_year_is_leap_cpp",                  (DL_FUNC) &_shide_year_is_leap_cpp,                  1},
     {NULL, NULL, 0}
 };
 }
 
+void init_compact_seq(DllInfo* dll);
 extern "C" attribute_visible void R_init_shide(DllInfo* dll){
   R_registerRoutines(dll, NULL, CallEntries, NULL, NULL);
   R_useDynamicSymbols(dll, FALSE);
+  init_compact_seq(dll);
   R_forceSymbols(dll, TRUE);
 }
@@ -1,124 +1,314 @@
 #include "shide.h"
+#include <shide/batch.h>
+#include <shide/format.h>
+#include <shide/parallel.h>
+#include <shide/utils.h>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <type_traits>
 
 std::string get_current_tzone_cpp();
 
-[[cpp11::register]]
-cpp11::writable::strings
-format_jdate_cpp(const cpp11::doubles x,
-                   const cpp11::strings& format)
+namespace
 {
-    if (format.size() != 1) {
-        cpp11::stop("`format` must have size 1.");
+    // number of elements that a thread formats in a round of format_strings()
+    constexpr std::size_t ROUND_SIZE{ 65536 };
+
+    // sizes marking an element as missing, as equal to the previous one or as found in the
+    // charsxp_cache
+    constexpr int NA_SIZE{ -1 };
+    constexpr int REPEAT_SIZE{ -2 };
+    constexpr int CACHED_SIZE{ -3 };
+
+    // the strings formatted by a thread in a round, stored one after another in `buf`, and the
+    // CHARSXPs of the elements found in the cache
+    struct format_chunk
+    {
+        std::string buf;
+        std::vector<int> sizes;
+        std::vector<SEXP> cached;
+    };
+
+    // A direct-mapped cache from the value of an element to the CHARSXP it was formatted to, so
+    // that values recurring in a vector, as the days of grouped data do, are neither formatted
+    // nor looked up in R's global CHARSXP cache again. The CHARSXPs are kept alive by the output
+    // vector. Only the main thread adds entries, between the rounds of format_strings(), so
+    // threads may look values up during a round.
+    class charsxp_cache
+    {
+        static constexpr int BITS{ 12 };
+
+        struct entry
+        {
+            double key;
+            SEXP value;
+        };
+
+        std::vector<entry> entries_;
+
+        static std::size_t slot(const double key)
+        {
+            std::uint64_t bits;
+            std::memcpy(&bits, &key, sizeof bits);
+            return static_cast<std::size_t>(bits * 0x9E3779B97F4A7C15ull >> (64 - BITS));
+        }
+
+    public:
+        charsxp_cache()
+            : entries_(std::size_t{ 1 } << BITS,
+                       entry{ std::numeric_limits<double>::quiet_NaN(), nullptr })
+        {}
+
+        // the CHARSXP of `key`, or nullptr; NaN is never found
+        SEXP find(const double key) const
+        {
+            const entry& e = entries_[slot(key)];
+            return e.key == key ? e.value : nullptr;
+        }
+
+        void insert(const double key, const SEXP value)
+        {
+            entries_[slot(key)] = entry{ key, value };
+        }
+    };
+
+    // Formats the `size` elements of `out` in rounds. In a round the elements are split among
+    // the threads of a thread_pool started once per call, each writing strings into its own
+    // buffer with a formatter created by `make()`, and the main thread then turns the strings
+    // into CHARSXPs, as the R API must not be called from other threads. A formatter appends element `i` to a buffer and returns false
+    // if the element formats as NA. Elements are identified by `key(i)`: an element with the key
+    // of the previous one takes its string, and strings of recurring keys come from a
+    // charsxp_cache.
+    template <class MakeFormatter, class Key>
+    void
+    format_strings(const SEXP out, const R_xlen_t size, const int n_threads, MakeFormatter make,
+                   Key key)
+    {
+        const std::size_t n_slots{ usable_threads(n_threads) };
+        thread_pool pool{ n_slots };
+        std::vector<decltype(make())> formatters;
+        formatters.reserve(n_slots);
+        for (std::size_t k = 0; k < n_slots; ++k)
+            formatters.push_back(make());
+
+        std::vector<format_chunk> chunks(n_slots);
+        charsxp_cache cache;
+        const R_xlen_t round_size = static_cast<R_xlen_t>(ROUND_SIZE * n_slots);
+
+        for (R_xlen_t r = 0; r < size; r += round_size)
+        {
+            const std::size_t n{ static_cast<std::size_t>(std::min(round_size, size - r)) };
+            const std::size_t n_chunks{ num_chunks(n, n_slots) };
+
+            pool.parallel_for(n, n_chunks, [&](const std::size_t k, const std::size_t b,
+                                          const std::size_t e) {
+                auto& chunk = chunks[k];
+                chunk.buf.clear();
+                chunk.sizes.clear();
+                chunk.cached.clear();
+
+                const R_xlen_t first{ r + static_cast<R_xlen_t>(b) };
+                const R_xlen_t last{ r + static_cast<R_xlen_t>(e) };
+                for (R_xlen_t i = first; i < last; ++i) {
+                    const double k_i{ key(i) };
+                    if (i > 0 && k_i == key(i - 1)) {
+                        chunk.sizes.push_back(REPEAT_SIZE);
+                        continue;
+                    }
+
+                    if (const SEXP cached = cache.find(k_i)) {
+                        chunk.sizes.push_back(CACHED_SIZE);
+                        chunk.cached.push_back(cached);
+                        continue;
+                    }
+
+                    const std::size_t before{ chunk.buf.size() };
+                    if (formatters[k](i, chunk.buf)) {
+                        chunk.sizes.push_back(static_cast<int>(chunk.buf.size() - before));
+                    } else {
+                        chunk.buf.resize(before);
+                        chunk.sizes.push_back(NA_SIZE);
+                    }
+                }
+            });
+
+            R_xlen_t i = r;
+            for (std::size_t k = 0; k < n_chunks; ++k) {
+                const char* p = chunks[k].buf.data();
+                auto cached = chunks[k].cached.cbegin();
+                for (const int s : chunks[k].sizes) {
+                    if (s == REPEAT_SIZE) {
+                        SET_STRING_ELT(out, i, STRING_ELT(out, i - 1));
+                    } else if (s == NA_SIZE) {
+                        SET_STRING_ELT(out, i, NA_STRING);
+                    } else if (s == CACHED_SIZE) {
+                        SET_STRING_ELT(out, i, *cached++);
+                    } else {
+                        const SEXP str = Rf_mkCharLenCE(p, s, CE_UTF8);
+                        SET_STRING_ELT(out, i, str);
+                        cache.insert(key(i), str);
+                        p += s;
+                    }
+                    ++i;
+                }
+            }
+        }
     }
 
-    const R_xlen_t size = x.size();
-    cpp11::writable::strings out(size);
+    format_locale
+    make_format_locale(const std::string& names, const std::string& numerals)
+    {
+        const auto names_ = string_to_names(names);
+        if (!names_) {
+            cpp11::stop("`names` must be one of \"en\" or \"fa\".");
+        }
 
-    const std::string format_(format[0]);
-    const char* fmt = format_.c_str();
+        const auto digits_ = string_to_digits(numerals);
+        if (!digits_) {
+            cpp11::stop("`numerals` must be one of \"latin\", \"persian\" or \"arabic\".");
+        }
 
-    date::local_days ld;
-    sh_year_month_day ymd{};
-    date::year_month_day ymd2{};
+        return format_locale{ *names_, *digits_ };
+    }
 
-    std::ostringstream os;
-    os.imbue(std::locale::classic());
+    template <class T>
+    class jdate_formatter
+    {
+        const T* x_;
+        const format_program* program_;
+        sh_ymd_cursor cursor_{};
+        std::ostringstream os_{};
 
-    for (R_xlen_t i = 0; i < size; ++i) {
-        if (std::isnan(x[i])) {
-            SET_STRING_ELT(out, i, NA_STRING);
-            continue;
+    public:
+        jdate_formatter(const T* x, const format_program& program)
+            : x_{ x }, program_{ &program }
+        {
+            os_.imbue(std::locale::classic());
         }
 
-        os.str(std::string());
-        os.clear();
+        bool operator()(const R_xlen_t i, std::string& buf)
+        {
+            if (!detail::days_ok(x_[i]))
+                return false;
 
-        ld = date::local_days{ date::days(static_cast<int>(x[i]))};
-        ymd = sh_year_month_day{ ld };
-        ymd2 = {ymd.year(), ymd.month(), ymd.day()};
+            const auto p = cursor_(detail::days_to_jd(x_[i], true));
+            return program_->write(buf, format_fields{ p, 0, std::chrono::seconds{ 0 } }, os_);
+        }
+    };
 
-        date::to_stream(os, fmt, ymd2);
+    class jdatetime_formatter
+    {
+        const double* x_;
+        const format_program* program_;
+        const std::string* tz_name_;
+        sys_info_cursor tz_cursor_;
+        sh_ymd_cursor cursor_{};
+        std::ostringstream os_{};
 
-        if (os.fail()) {
-            SET_STRING_ELT(out, i, NA_STRING);
-            continue;
+    public:
+        jdatetime_formatter(const double* x, const format_program& program,
+                            const std::string& tz_name, const sys_info_cursor& tz_cursor)
+            : x_{ x }, program_{ &program }, tz_name_{ &tz_name }, tz_cursor_{ tz_cursor }
+        {
+            os_.imbue(std::locale::classic());
         }
 
-        std::string str = os.str();
-        SET_STRING_ELT(out, i, Rf_mkCharLenCE(str.c_str(), str.size(), CE_UTF8));
+        bool operator()(const R_xlen_t i, std::string& buf)
+        {
+            if (std::isnan(x_[i]))
+                return false;
+
+            const date::sys_seconds ss{ sys_seconds_from_double(x_[i]) };
+            const auto& info = tz_cursor_(ss);
+            const date::local_seconds ls{ (ss + info.offset).time_since_epoch() };
+            const date::local_days ld{ date::floor<date::days>(ls) };
+            const int jd{ static_cast<int>(ld.time_since_epoch().count()) + internal::JD_UNIX_EPOCH };
+
+            if (!detail::jd_in_range(jd))
+                return false;
+
+            const auto p = cursor_(jd);
+            const auto secs = static_cast<int>((ls - date::local_seconds{ ld }).count());
+            return program_->write(buf, format_fields{ p, secs, info.offset }, os_, *tz_name_);
+        }
+    };
+}
+
+[[cpp11::register]]
+cpp11::writable::strings
+format_jdate_cpp(const cpp11::sexp x,
+                   const cpp11::strings& format,
+                   const std::string& names,
+                   const std::string& numerals,
+                   const int n_threads)
+{
+    if (format.size() != 1) {
+        cpp11::stop("`format` must have size 1.");
     }
 
+    const format_locale locale{ make_format_locale(names, numerals) };
+
+    const R_xlen_t size = Rf_xlength(x);
+    cpp11::writable::strings out(size);
+
+    const std::string format_(format[0]);
+    const auto program = format_program::compile(format_, false, locale);
+
+    visit_days(x, [&](const auto* xx) {
+        using T = std::remove_cv_t<std::remove_pointer_t<decltype(xx)>>;
+        format_strings(
+            out, size, n_threads,
+            [&] { return jdate_formatter<T>(xx, program); },
+            [&](const R_xlen_t i) { return static_cast<double>(xx[i]); });
+    });
+
     return out;
 }
 
 [[cpp11::register]]
 cpp11::writable::strings
 format_jdatetime_cpp(const cpp11::sexp x,
-                       const cpp11::strings& format)
+                       const cpp11::strings& format,
+                       const std::string& names,
+                       const std::string& numerals,
+                       const int n_threads)
 {
     if (format.size() != 1) {
         cpp11::stop("`format` must have size 1.");
     }
 
+    const format_locale locale{ make_format_locale(names, numerals) };
+
     const cpp11::doubles xx = cpp11::as_cpp<cpp11::doubles>(x);
     const cpp11::strings tz_name_ =  cpp11::as_cpp<cpp11::strings>(x.attr("tzone"));
     std::string tz_name(tz_name_[0]);
-    const date::time_zone* tz{};
 
     if (!tz_name.size())
     {
         tz_name = get_current_tzone_cpp();
     }
 
-    if (!tzdb::locate_zone(tz_name, tz))
+    const zone_table* table{ locate_zone_table(tz_name) };
+    if (!table)
     {
         cpp11::stop(std::string(tz_name + " not found in timezone database").c_str());
     }
 
-    date::local_seconds ls;
-    date::sys_seconds ss;
-    date::local_days ld;
-    sh_year_month_day ymd{};
-    date::year_month_day ymd2{};
-    date::sys_info info;
-
     const R_xlen_t size = xx.size();
     cpp11::writable::strings out(size);
 
-    std::string format_(format[0]);
-    const char* fmt = format_.c_str();
-
-    std::ostringstream os;
-    os.imbue(std::locale::classic());
+    const double* px = REAL_RO(xx);
+    const sys_info_cursor tz_cursor(*table, px, size);
 
-    for (R_xlen_t i = 0; i < size; ++i) {
-        if (std::isnan(xx[i])) {
-            SET_STRING_ELT(out, i, NA_STRING);
-            continue;
-        }
-
-        os.str(std::string());
-        os.clear();
-
-        ss = sys_seconds_from_double(xx[i]);
-        tzdb::get_sys_info(ss, tz, info);
-        ls = date::local_seconds{(ss + info.offset).time_since_epoch()};
-        ld = date::floor<date::days>(ls);
-        auto tod = date::hh_mm_ss<std::chrono::seconds>{ ls - date::local_seconds{ ld } };
-        ymd = sh_year_month_day{ ld };
-        ymd2 = {ymd.year(), ymd.month(), ymd.day()};
-
-        date::fields<std::chrono::seconds> fds{ ymd2, tod };
-        date::to_stream(os, fmt, fds, &tz_name, &info.offset);
-
-        if (os.fail()) {
-            SET_STRING_ELT(out, i, NA_STRING);
-            continue;
-        }
+    std::string format_(format[0]);
+    const auto program = format_program::compile(format_, true, locale);
 
-        std::string str = os.str();
-        SET_STRING_ELT(out, i, Rf_mkCharLenCE(str.c_str(), str.size(), CE_UTF8));
-    }
+    format_strings(
+        out, size, n_threads,
+        [&] { return jdatetime_formatter(px, program, tz_name, tz_cursor); },
+        [&](const R_xlen_t i) { return px[i]; });
 
     return out;
 }
@@ -25,3 +25,49 @@ cpp11::writable::logicals year_is_leap_cpp(const cpp11::integers& x)
 
     return out;
 }
+
+[[cpp11::register]]
+cpp11::writable::integers days_in_year_cpp(const cpp11::integers& x)
+{
+    using namespace internal;
+    const R_xlen_t size = x.size();
+    cpp11::writable::integers out(size);
+    for (R_xlen_t i = 0; i < size; ++i)
+    {
+        if (x[i] == NA_INTEGER)
+        {
+            out[i] = NA_INTEGER;
+            continue;
+        }
+
+        if (x[i] < LOWER_PERSIAN_YEAR || x[i] > UPPER_PERSIAN_YEAR)
+            cpp11::stop("year is out of valid range.");
+
+        out[i] = 365 + detail::is_leap(x[i]);
+    }
+
+    return out;
+}
+
+[[cpp11::register]]
+cpp11::writable::integers days_in_month_cpp(const cpp11::integers& year, const cpp11::integers& month)
+{
+    using namespace internal;
+    const R_xlen_t size = year.size();
+    cpp11::writable::integers out(size);
+    for (R_xlen_t i = 0; i < size; ++i)
+    {
+        if (year[i] == NA_INTEGER || month[i] < 1 || month[i] > 12)
+        {
+            out[i] = NA_INTEGER;
+            continue;
+        }
+
+        if (year[i] < LOWER_PERSIAN_YEAR || year[i] > UPPER_PERSIAN_YEAR)
+            cpp11::stop("year is out of valid range.");
+
+        out[i] = detail::days_in_month(year[i], month[i]);
+    }
+
+    return out;
+}
@@ -1,4 +1,5 @@
 #include "shide.h"
+#include <shide/batch.h>
 #include <shide/make.h>
 
 using cpp11::integers;
@@ -15,18 +16,8 @@ doubles jdate_make_cpp(cpp11::list_of<cpp11::integers> fields) {
 
     const R_xlen_t size = year.size();
     cpp11::writable::doubles out(size);
-    std::optional<double> d{};
 
-    for (R_xlen_t i = 0; i < size; ++i) {
-        if (year[i] == NA_INTEGER) {
-            out[i] = NA_REAL;
-            continue;
-        }
-
-        auto ymd = sh_year_month_day{date::year(year[i]), date::month(month[i]), date::day(day[i])};
-        d = make_jdate(ymd);
-        out[i] = d.has_value() ? *d : NA_REAL;
-    }
+    sh_days_from_ymd(INTEGER(year), INTEGER(month), INTEGER(day), size, REAL(out), NA_REAL);
 
     return out;
 }
@@ -34,24 +25,23 @@ doubles jdate_make_cpp(cpp11::list_of<cpp11::integers> fields) {
 doubles
 jdatetime_make_impl(const integers& year, const integers& month, const integers& day,
                     const integers& hour, const integers& minute, const integers& second,
-                    const date::time_zone* tz, const choose c)
+                    const zone_table& table, const choose c)
 {
     const R_xlen_t size = year.size();
     cpp11::writable::doubles out(size);
-    date::local_info info;
-    struct sh_fields fds{};
-    std::optional<double> dt{};
+    local_info_cursor cursor{ table };
+    std::optional<date::local_seconds> ls{};
+    double dt{};
 
     for (R_xlen_t i = 0; i < size; ++i) {
-        if (year[i] == NA_INTEGER) {
+        ls = make_local_seconds(year[i], month[i], day[i], hour[i], minute[i], second[i]);
+        if (!ls.has_value()) {
             out[i] = NA_REAL;
             continue;
         }
 
-        fds.ymd = {date::year(year[i]), date::month(month[i]), date::day(day[i])};
-        fds.tod = {hours(hour[i]), minutes(minute[i]), seconds(second[i])};
-        dt = make_jdatetime(fds, tz, info, c);
-        out[i] = dt.has_value() ? *dt : NA_REAL;
+        dt = jdatetime_from_local_seconds(*ls, cursor, c);
+        out[i] = std::isnan(dt) ? NA_REAL : dt;
     }
 
     return out;
@@ -68,46 +58,44 @@ doubles jdatetime_make_cpp(cpp11::list_of<cpp11::integers> fields,
     }
 
     const auto Ambiguous{*opt};
-    const date::time_zone* tz{};
     const std::string tz_name(tzone[0]);
 
-    if (!tzdb::locate_zone(tz_name, tz))
+    const zone_table* table{ locate_zone_table(tz_name) };
+    if (!table)
     {
         cpp11::stop(std::string(tz_name + " not found in timezone database").c_str());
     }
 
     return jdatetime_make_impl(fields[0], fields[1], fields[2], fields[3], fields[4], fields[5],
-                               tz, Ambiguous);
+                               *table, Ambiguous);
 }
 
 doubles jdatetime_make_with_reference_impl(const integers& year, const integers& month, const integers& day,
                                            const integers& hour, const integers& minute, const integers& second,
-                                           const date::time_zone* tz, const doubles& ref) {
+                                           const zone_table& table, const doubles& ref) {
     const R_xlen_t size = year.size();
     cpp11::writable::doubles out(size);
-    date::local_info info;
+    local_info_cursor cursor{ table };
     date::sys_seconds ss_ref{};
-    struct sh_fields fds{};
-    std::optional<double> dt{};
+    std::optional<date::local_seconds> ls{};
+    double dt{};
 
     for (R_xlen_t i = 0; i < size; ++i) {
-        if (year[i] == NA_INTEGER) {
+        ls = make_local_seconds(year[i], month[i], day[i], hour[i], minute[i], second[i]);
+        if (!ls.has_value()) {
             out[i] = NA_REAL;
             continue;
         }
 
-        fds.ymd = {date::year(year[i]), date::month(month[i]), date::day(day[i])};
-        fds.tod = {hours(hour[i]), minutes(minute[i]), seconds(second[i])};
-
         if (std::isnan(ref[i])) {
-            dt = make_jdatetime(fds, tz, info, choose::NA);
-            out[i] = dt.has_value() ? *dt : NA_REAL;
+            dt = jdatetime_from_local_seconds(*ls, cursor, choose::NA);
+            out[i] = std::isnan(dt) ? NA_REAL : dt;
             continue;
         }
 
         ss_ref = sys_seconds_from_double(ref[i]);
-        dt = make_jdatetime(fds, tz, info, ss_ref);
-        out[i] = dt.has_value() ? *dt : NA_REAL;
+        dt = jdatetime_from_local_seconds(*ls, cursor, choose{}, &ss_ref);
+        out[i] = std::isnan(dt) ? NA_REAL : dt;
     }
 
     return out;
@@ -117,15 +105,15 @@ doubles jdatetime_make_with_reference_impl(const integers& year, const integers&
 doubles jdatetime_make_with_reference_cpp(cpp11::list_of<cpp11::integers> fields,
                                           const cpp11::strings& tzone, const cpp11::sexp x)
 {
-    const date::time_zone* tz{};
     const std::string tz_name(tzone[0]);
 
-    if (!tzdb::locate_zone(tz_name, tz))
+    const zone_table* table{ locate_zone_table(tz_name) };
+    if (!table)
     {
         cpp11::stop(std::string(tz_name + " not found in timezone database").c_str());
     }
 
     const doubles xx = cpp11::as_cpp<cpp11::doubles>(x);
     return jdatetime_make_with_reference_impl(fields[0], fields[1], fields[2],
-                                              fields[3], fields[4], fields[5], tz, xx);
+                                              fields[3], fields[4], fields[5], *table, xx);
 }
@@ -1,140 +1,500 @@
 #include "shide.h"
 #include <shide/make.h>
+#include <shide/parallel.h>
+#include <shide/parse.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <string_view>
 
-[[cpp11::register]]
-cpp11::writable::doubles
-jdate_parse_cpp(const cpp11::strings& x, const cpp11::strings& format)
+namespace
 {
-    if (format.size() != 1) {
-        cpp11::stop("`format` must have size 1.");
+    // number of elements that a thread parses in a round of parse_strings()
+    constexpr std::size_t ROUND_SIZE{ 65536 };
+
+    // The UTF-8 text of `elt`. Strings marked as UTF-8 and native strings of ASCII characters are
+    // used in place; others are translated into memory that vmaxset() releases.
+    std::string_view
+    utf8_text(const SEXP elt)
+    {
+        const char* first{ CHAR(elt) };
+        const std::size_t size{ static_cast<std::size_t>(LENGTH(elt)) };
+        const cetype_t ce{ Rf_getCharCE(elt) };
+        if (ce == CE_UTF8 ||
+            (ce == CE_NATIVE && std::all_of(first, first + size, [](const char c) {
+                 return static_cast<unsigned char>(c) < 0x80;
+             })))
+            return std::string_view(first, size);
+
+        return Rf_translateCharUTF8(elt);
     }
 
-    const R_xlen_t size = x.size();
-    cpp11::writable::doubles out(size);
+    // Remembers the values parsed from strings, keyed on their CHARSXPs. R keeps a single CHARSXP
+    // for equal strings, so a repeated string is found by its address without being translated
+    // or parsed again. The table uses open addressing and doubles as it fills. It checks its hit
+    // rate over windows of lookups and gives up if few strings repeat, as in columns of distinct
+    // date-times, where it would only cost time and memory.
+    class charsxp_memo
+    {
+        struct entry
+        {
+            SEXP key;
+            double value;
+            // while the value is being parsed, the index in the round of the string it comes from
+            std::ptrdiff_t pending;
+        };
 
-    std::string format_(format[0]);
-    const char* fmt = format_.c_str();
+        static constexpr std::size_t MIN_CAPACITY{ 1024 };
+        static constexpr std::size_t WINDOW{ 16384 };
+        // the fewest hits in a window for the table to be kept
+        static constexpr std::size_t MIN_HITS{ WINDOW / 8 };
 
-    std::istringstream is;
-    std::chrono::minutes* offptr{};
-    std::string* abbrev{};
-    std::optional<double> d{};
+        std::vector<entry> entries_;
+        std::vector<SEXP> pending_;
+        std::size_t count_{ 0 };
+        std::size_t lookups_{ 0 };
+        std::size_t hits_{ 0 };
+        bool enabled_{ true };
 
-    for (R_xlen_t i = 0; i < size; ++i)
-    {
-        const SEXP elt = x[i];
+        std::size_t slot(const SEXP key) const
+        {
+            const std::size_t mask{ entries_.size() - 1 };
+            std::size_t i{ static_cast<std::size_t>(
+                (reinterpret_cast<std::uintptr_t>(key) >> 4) * 0x9E3779B97F4A7C15ull >> 20) & mask };
+            while (entries_[i].key && entries_[i].key != key)
+                i = (i + 1) & mask;
 
-        if (elt == NA_STRING)
+            return i;
+        }
+
+        void grow()
         {
-            out[i] = NA_REAL;
-            continue;
+            std::vector<entry> old(entries_.size() * 2, entry{ nullptr, 0, -1 });
+            old.swap(entries_);
+            for (const auto& e : old)
+            {
+                if (e.key)
+                    entries_[slot(e.key)] = e;
+            }
         }
 
-        const char* p_elt = Rf_translateCharUTF8(elt);
-        is.str(p_elt);
-        is.clear();
-        is.seekg(0);
+        void disable()
+        {
+            enabled_ = false;
+            std::vector<entry>().swap(entries_);
+            std::vector<SEXP>().swap(pending_);
+        }
 
-        date::fields<std::chrono::seconds> fds{};
-        date::from_stream(is, fmt, fds, abbrev, offptr);
+    public:
+        charsxp_memo() : entries_(MIN_CAPACITY, entry{ nullptr, 0, -1 }) {}
 
-        if (is.fail())
+        bool enabled() const { return enabled_; }
+
+        // the entry of `key`, or nullptr if it is new, in which case it is added as pending on
+        // element `index` of the round
+        const entry* find_or_add(const SEXP key, const std::ptrdiff_t index)
         {
-            out[i] = NA_REAL;
-            continue;
+            if (++lookups_ == WINDOW)
+            {
+                if (hits_ < MIN_HITS)
+                {
+                    disable();
+                    return nullptr;
+                }
+                lookups_ = 0;
+                hits_ = 0;
+            }
+
+            std::size_t i{ slot(key) };
+            if (entries_[i].key)
+            {
+                ++hits_;
+                return &entries_[i];
+            }
+
+            if (2 * (count_ + 1) > entries_.size())
+            {
+                grow();
+                i = slot(key);
+            }
+
+            entries_[i] = entry{ key, 0, index };
+            pending_.push_back(key);
+            ++count_;
+            return nullptr;
         }
 
-        auto ymd = sh_year_month_day{fds.ymd.year(), fds.ymd.month(), fds.ymd.day()};
-        d = make_jdate(ymd);
-        out[i] = d.has_value() ? *d : NA_REAL;
-    }
+        // stores the values of the strings added in the round starting at `out`
+        void settle(const double* out)
+        {
+            for (const SEXP key : pending_)
+            {
+                auto& e = entries_[slot(key)];
+                e.value = out[e.pending];
+                e.pending = -1;
+            }
 
-    return out;
-}
+            pending_.clear();
+        }
+    };
 
-[[cpp11::register]]
-cpp11::writable::doubles
-jdatetime_parse_cpp(const cpp11::strings& x, const cpp11::strings& format,
-                    const cpp11::strings& tzone, const std::string& ambiguous)
-{
-    if (format.size() != 1) {
-        cpp11::stop("`format` must have size 1.");
-    }
+    // what to do with an element of a round in parse_strings(); other values are the index of an
+    // earlier element of the round whose value is copied
+    constexpr std::ptrdiff_t PARSE{ -1 };
+    constexpr std::ptrdiff_t DONE{ -2 };
 
-    const auto opt{ string_to_choose(ambiguous) };
+    // Parses the `size` strings of `x` into `out` in rounds. The main thread collects the UTF-8
+    // text of a round, as reading or translating it needs the R API, and the round is then split
+    // among the threads of a thread_pool started once per call, each parsing with a parser
+    // created by `make()` that returns the value of a string or NA_REAL. Strings seen before are looked up in a charsxp_memo instead.
+    template <class MakeParser>
+    void
+    parse_strings(const SEXP x, double* out, const R_xlen_t size, const int n_threads,
+                  MakeParser make)
+    {
+        const std::size_t n_slots{ usable_threads(n_threads) };
+        thread_pool pool{ n_slots };
+        std::vector<decltype(make())> parsers;
+        parsers.reserve(n_slots);
+        for (std::size_t k = 0; k < n_slots; ++k)
+            parsers.push_back(make());
 
-    if (!opt) {
-        cpp11::stop("Invalid ambiguous relolution strategy");
+        const R_xlen_t round_size = static_cast<R_xlen_t>(ROUND_SIZE * n_slots);
+        std::vector<std::string_view> text;
+        std::vector<std::ptrdiff_t> action;
+        charsxp_memo memo;
+
+        for (R_xlen_t r = 0; r < size; r += round_size)
+        {
+            const std::size_t n{ static_cast<std::size_t>(std::min(round_size, size - r)) };
+            double* out_r = out + r;
+
+            // translations are allocated with R_alloc() and only needed during the round
+            const void* vmax = vmaxget();
+            text.resize(n);
+            action.resize(n);
+            for (std::size_t j = 0; j < n; ++j) {
+                const SEXP elt = STRING_ELT(x, r + static_cast<R_xlen_t>(j));
+                text[j] = {};
+
+                if (elt == NA_STRING) {
+                    out_r[j] = NA_REAL;
+                    action[j] = DONE;
+                    continue;
+                }
+
+                if (memo.enabled()) {
+                    const auto* e = memo.find_or_add(elt, static_cast<std::ptrdiff_t>(j));
+                    if (e && e->pending >= 0) {
+                        action[j] = e->pending;
+                        continue;
+                    }
+                    if (e) {
+                        out_r[j] = e->value;
+                        action[j] = DONE;
+                        continue;
+                    }
+                }
+
+                text[j] = utf8_text(elt);
+                action[j] = PARSE;
+            }
+
+            pool.parallel_for(n, num_chunks(n, n_slots), [&](const std::size_t k,
+                                                             const std::size_t b,
+                                                             const std::size_t e) {
+                for (std::size_t j = b; j < e; ++j) {
+                    if (action[j] == PARSE)
+                        out_r[j] = parsers[k](text[j]);
+                }
+            });
+
+            for (std::size_t j = 0; j < n; ++j) {
+                if (action[j] >= 0)
+                    out_r[j] = out_r[action[j]];
+            }
+
+            if (memo.enabled())
+                memo.settle(out_r);
+
+            vmaxset(vmax);
+        }
     }
 
-    const auto Ambiguous{*opt};
-    const date::time_zone* tz{};
-    date::local_info info;
-    const std::string tz_name(tzone[0]);
+    // a candidate format of a parse, its fixed layout and the separator of its date fields
+    struct parse_format
+    {
+        std::string fmt;
+        ParseLayout layout;
+        char date_sep;
+    };
 
-    if (!tzdb::locate_zone(tz_name, tz))
+    std::vector<parse_format>
+    make_parse_formats(const cpp11::strings& format)
     {
-        cpp11::stop(std::string(tz_name + " not found in timezone database").c_str());
+        std::vector<parse_format> formats;
+        formats.reserve(format.size());
+        for (R_xlen_t i = 0; i < format.size(); ++i) {
+            const SEXP elt = format[i];
+            if (elt == NA_STRING) {
+                cpp11::stop("`format` must not contain `NA`.");
+            }
+            std::string fmt(Rf_translateCharUTF8(elt));
+            const ParseLayout layout{ string_to_parse_layout(fmt) };
+            const char date_sep{ format_date_separator(fmt) };
+            formats.push_back(parse_format{ std::move(fmt), layout, date_sep });
+        }
+
+        return formats;
     }
 
-    const R_xlen_t size = x.size();
-    cpp11::writable::doubles out(size);
+    // number of elements of the input sampled by rank_formats()
+    constexpr R_xlen_t SAMPLE_SIZE{ 256 };
 
-    std::string format_(format[0]);
-    const char* fmt = format_.c_str();
+    // Orders the candidate `formats` by the number of elements of an evenly spaced sample of `x`
+    // that they match in full, keeping the given order among formats that match as many, so
+    // that the parsers try the format most likely to succeed first. Runs on the main thread
+    // with a parser created by `make()`.
+    template <class MakeParser>
+    void
+    rank_formats(const SEXP x, const R_xlen_t size, std::vector<parse_format>& formats,
+                 MakeParser make)
+    {
+        if (formats.size() < 2 || size == 0)
+            return;
 
-    std::istringstream is;
-    std::chrono::minutes* offptr{};
-    std::string* abbrev{};
-    sh_year_month_day ymd{};
-    sh_fields sh_fds{};
-    sh_fds.has_tod = true;
-    std::optional<double> dt{};
+        auto parser = make();
+        std::vector<std::size_t> hits(formats.size());
+        const R_xlen_t step{ size > SAMPLE_SIZE ? size / SAMPLE_SIZE : 1 };
 
-    for (R_xlen_t i = 0; i < size; ++i)
-    {
-        const SEXP elt = x[i];
+        const void* vmax = vmaxget();
+        for (R_xlen_t i = 0; i < size; i += step) {
+            const SEXP elt = STRING_ELT(x, i);
+            if (elt == NA_STRING)
+                continue;
 
-        if (elt == NA_STRING)
-        {
-            out[i] = NA_REAL;
-            continue;
+            const std::string_view text{ utf8_text(elt) };
+            for (std::size_t f = 0; f < formats.size(); ++f) {
+                if (!std::isnan(parser.parse(text, formats[f], true)))
+                    ++hits[f];
+            }
         }
+        vmaxset(vmax);
+
+        std::vector<std::size_t> order(formats.size());
+        for (std::size_t f = 0; f < order.size(); ++f)
+            order[f] = f;
+        std::stable_sort(order.begin(), order.end(), [&](const std::size_t a, const std::size_t b) {
+            return hits[a] > hits[b];
+        });
+
+        std::vector<parse_format> ranked;
+        ranked.reserve(formats.size());
+        for (const std::size_t f : order)
+            ranked.push_back(std::move(formats[f]));
+        formats.swap(ranked);
+    }
 
-        const char* p_elt = Rf_translateCharUTF8(elt);
-        is.str(p_elt);
-        is.clear();
-        is.seekg(0);
+    // Parsers try the candidate formats in turn until one gives a value. A single format ignores
+    // anything after the fields, as date::from_stream() does. Several candidates must all match
+    // the whole string, whatever their rank, so that a shorter format doesn't pick up the
+    // leading part of a string meant for a longer one and the result doesn't depend on the mix
+    // of the input. Strings that no candidate matches in full are then tried with the `lenient`
+    // formats, in their given order, ignoring anything after the fields.
+    class jdate_parser
+    {
+        const std::vector<parse_format>* formats_;
+        const std::vector<parse_format>* lenient_;
+        std::istringstream is_{};
+        // `text` with ASCII digits, for date::from_stream()
+        std::string buf_{};
+        parsed_fields pfds_{};
 
-        date::fields<std::chrono::seconds> fds{};
-        fds.has_tod = true;
-        date::from_stream(is, fmt, fds, abbrev, offptr);
+    public:
+        jdate_parser(const std::vector<parse_format>& formats,
+                     const std::vector<parse_format>& lenient)
+            : formats_{ &formats }, lenient_{ &lenient }
+        {}
 
-        if (is.fail())
+        double parse(const std::string_view text, const parse_format& format, const bool strict)
         {
-            out[i] = NA_REAL;
-            continue;
+            std::optional<double> d{};
+
+            if (parse_fixed(format.layout, text.data(), text.data() + text.size(), pfds_))
+            {
+                d = make_jdate(sh_year_month_day{ date::year(pfds_.y), date::month(pfds_.m),
+                                                  date::day(pfds_.d) });
+                return d.has_value() ? *d : NA_REAL;
+            }
+
+            is_.str(normalize_digits(text, buf_, format.date_sep) ? buf_ : std::string(text));
+            is_.clear();
+            is_.seekg(0);
+
+            std::chrono::minutes* offptr{};
+            std::string* abbrev{};
+            date::fields<std::chrono::seconds> fds{};
+            date::from_stream(is_, format.fmt.c_str(), fds, abbrev, offptr);
+
+            if (is_.fail())
+                return NA_REAL;
+
+            if (strict && is_.peek() != std::istringstream::traits_type::eof())
+                return NA_REAL;
+
+            auto ymd = sh_year_month_day{fds.ymd.year(), fds.ymd.month(), fds.ymd.day()};
+            d = make_jdate(ymd);
+            return d.has_value() ? *d : NA_REAL;
         }
 
-        if (!fds.tod.in_conventional_range())
+        double operator()(const std::string_view text)
         {
-            out[i] = NA_REAL;
-            continue;
+            const auto& formats = *formats_;
+            const bool strict{ formats.size() > 1 };
+            double d{ parse(text, formats[0], strict) };
+            for (std::size_t f = 1; f < formats.size() && std::isnan(d); ++f)
+                d = parse(text, formats[f], strict);
+            for (std::size_t f = 0; f < lenient_->size() && std::isnan(d); ++f)
+                d = parse(text, (*lenient_)[f], false);
+
+            return d;
         }
+    };
 
-        ymd = {fds.ymd.year(), fds.ymd.month(), fds.ymd.day()};
+    class jdatetime_parser
+    {
+        const std::vector<parse_format>* formats_;
+        const std::vector<parse_format>* lenient_;
+        choose ambiguous_;
+        local_info_cursor cursor_;
+        std::istringstream is_{};
+        // `text` with ASCII digits, for date::from_stream()
+        std::string buf_{};
+        parsed_fields pfds_{};
+
+    public:
+        jdatetime_parser(const std::vector<parse_format>& formats,
+                         const std::vector<parse_format>& lenient, const choose ambiguous,
+                         const zone_table& table)
+            : formats_{ &formats }, lenient_{ &lenient }, ambiguous_{ ambiguous }, cursor_{ table }
+        {}
 
-        if (!ymd.ok())
+        double parse(const std::string_view text, const parse_format& format, const bool strict)
         {
-            out[i] = NA_REAL;
-            continue;
+            sh_year_month_day ymd{};
+            sh_fields sh_fds{};
+            sh_fds.has_tod = true;
+
+            if (parse_fixed(format.layout, text.data(), text.data() + text.size(), pfds_))
+            {
+                ymd = {date::year(pfds_.y), date::month(pfds_.m), date::day(pfds_.d)};
+                sh_fds.tod = hour_minute_second(std::chrono::seconds{
+                    pfds_.h * 3600 + pfds_.mi * 60 + pfds_.s });
+            }
+            else
+            {
+                is_.str(normalize_digits(text, buf_, format.date_sep) ? buf_ : std::string(text));
+                is_.clear();
+                is_.seekg(0);
+
+                std::chrono::minutes* offptr{};
+                std::string* abbrev{};
+                date::fields<std::chrono::seconds> fds{};
+                fds.has_tod = true;
+                date::from_stream(is_, format.fmt.c_str(), fds, abbrev, offptr);
+
+                if (is_.fail())
+                    return NA_REAL;
+
+                if (strict && is_.peek() != std::istringstream::traits_type::eof())
+                    return NA_REAL;
+
+                if (!fds.tod.in_conventional_range())
+                    return NA_REAL;
+
+                ymd = {fds.ymd.year(), fds.ymd.month(), fds.ymd.day()};
+                sh_fds.tod = hour_minute_second(fds.tod.to_duration());
+            }
+
+            if (!ymd.ok())
+                return NA_REAL;
+
+            sh_fds.ymd = ymd;
+            const std::optional<double> dt{ make_jdatetime(sh_fds, cursor_, ambiguous_) };
+            return dt.has_value() ? *dt : NA_REAL;
+        }
+
+        double operator()(const std::string_view text)
+        {
+            const auto& formats = *formats_;
+            const bool strict{ formats.size() > 1 };
+            double dt{ parse(text, formats[0], strict) };
+            for (std::size_t f = 1; f < formats.size() && std::isnan(dt); ++f)
+                dt = parse(text, formats[f], strict);
+            for (std::size_t f = 0; f < lenient_->size() && std::isnan(dt); ++f)
+                dt = parse(text, (*lenient_)[f], false);
+
+            return dt;
         }
+    };
+}
+
+[[cpp11::register]]
+cpp11::writable::doubles
+jdate_parse_cpp(const cpp11::strings& x, const cpp11::strings& format,
+                const cpp11::strings& lenient, const int n_threads)
+{
+    if (format.size() < 1) {
+        cpp11::stop("`format` must have at least one element.");
+    }
+
+    std::vector<parse_format> formats{ make_parse_formats(format) };
+    const std::vector<parse_format> lenient_formats{ make_parse_formats(lenient) };
 
-        sh_fds.ymd = ymd;
-        sh_fds.tod = hour_minute_second(fds.tod.to_duration());
-        dt = make_jdatetime(sh_fds, tz, info, Ambiguous);
-        out[i] = dt.has_value() ? *dt : NA_REAL;
+    const R_xlen_t size = x.size();
+    cpp11::writable::doubles out(size);
+
+    const auto make = [&] { return jdate_parser(formats, lenient_formats); };
+    rank_formats(x, size, formats, make);
+    parse_strings(x, REAL(out), size, n_threads, make);
+
+    return out;
+}
+
+[[cpp11::register]]
+cpp11::writable::doubles
+jdatetime_parse_cpp(const cpp11::strings& x, const cpp11::strings& format,
+                    const cpp11::strings& lenient, const cpp11::strings& tzone,
+                    const std::string& ambiguous, const int n_threads)
+{
+    if (format.size() < 1) {
+        cpp11::stop("`format` must have at least one element.");
     }
 
+    std::vector<parse_format> formats{ make_parse_formats(format) };
+    const std::vector<parse_format> lenient_formats{ make_parse_formats(lenient) };
+
+    const auto opt{ string_to_choose(ambiguous) };
+
+    if (!opt) {
+        cpp11::stop("Invalid ambiguous relolution strategy");
+    }
+
+    const auto Ambiguous{*opt};
+    const std::string tz_name(tzone[0]);
+
+    const zone_table* table{ locate_zone_table(tz_name) };
+    if (!table)
+    {
+        cpp11::stop(std::string(tz_name + " not found in timezone database").c_str());
+    }
+
+    const R_xlen_t size = x.size();
+    cpp11::writable::doubles out(size);
+
+    const auto make = [&] { return jdatetime_parser(formats, lenient_formats, Ambiguous, *table); };
+    rank_formats(x, size, formats, make);
+    parse_strings(x, REAL(out), size, n_threads, make);
+
     return out;
 }
@@ -1,26 +1,41 @@
 #include "shide.h"
+#include <shide/bucket.h>
 #include <shide/round.h>
 #include <shide/make.h>
 #include <stdlib.h>
+#include <algorithm>
 
 std::string get_current_tzone_cpp();
 
-[[cpp11::register]]
-cpp11::writable::doubles
-jdate_ceiling_cpp(const cpp11::sexp x, const std::string& unit_name, const int n)
+// Applies `f` to the days of `x`, keeping the storage (double or integer) of the input
+template <class F>
+static
+cpp11::sexp
+map_jdate(const cpp11::sexp x, F f)
 {
-    const auto opt{ string_to_unit(unit_name) };
-    if (!opt)
-        cpp11::stop("Invalid unit: (%s)", unit_name.c_str());
+    const R_xlen_t size = Rf_xlength(x);
 
-    const auto unit{*opt};
-    if (unit < Unit::day)
-        cpp11::stop("Invalid unit: (%s)", unit_name.c_str());
+    if (TYPEOF(x) == INTSXP)
+    {
+        const int* xx = INTEGER_RO(x);
+        cpp11::writable::integers out(size);
+
+        for (R_xlen_t i = 0; i < size; ++i)
+        {
+            if (xx[i] == NA_INTEGER)
+            {
+                out[i] = NA_INTEGER;
+                continue;
+            }
+
+            out[i] = f(date::local_days{ date::days(xx[i]) }).time_since_epoch().count();
+        }
+
+        return out;
+    }
 
     const cpp11::doubles xx = cpp11::as_cpp<cpp11::doubles>(x);
-    const R_xlen_t size = xx.size();
     cpp11::writable::doubles out(size);
-    date::local_days ld;
 
     for (R_xlen_t i = 0; i < size; ++i)
     {
@@ -30,121 +45,229 @@ jdate_ceiling_cpp(const cpp11::sexp x, const std::string& unit_name, const int n
             continue;
         }
 
-        ld = date::local_days{ date::days(static_cast<int>(xx[i])) };
-        out[i] = make_jdate(ceiling_jdate(ld, unit, n));
+        out[i] = make_jdate(f(date::local_days{ date::days(static_cast<int>(xx[i])) }));
     }
 
     return out;
 }
 
-[[cpp11::register]]
-cpp11::writable::doubles
-jdate_floor_cpp(const cpp11::sexp x, const std::string& unit_name, const int n)
+// The unit named `unit_name`, which must be a date unit if `date_only`
+static
+Unit
+round_unit(const std::string& unit_name, const bool date_only)
 {
     const auto opt{ string_to_unit(unit_name) };
-    if (!opt)
-        cpp11::stop("Invalid unit: (%s)", unit_name.c_str());
-
-    const auto unit{*opt};
-    if (unit < Unit::day)
+    if (!opt || (date_only && *opt < Unit::day))
         cpp11::stop("Invalid unit: (%s)", unit_name.c_str());
 
-    const cpp11::doubles xx = cpp11::as_cpp<cpp11::doubles>(x);
-    const R_xlen_t size = xx.size();
-    cpp11::writable::doubles out(size);
-    date::local_days ld;
-
-    for (R_xlen_t i = 0; i < size; ++i)
-    {
-        if (std::isnan(xx[i]))
-        {
-            out[i] = NA_REAL;
-            continue;
-        }
-
-        ld = date::local_days{ date::days(static_cast<int>(xx[i])) };
-        out[i] = make_jdate(floor_jdate(ld, unit, n));
-    }
-
-    return out;
+    return *opt;
 }
 
-[[cpp11::register]]
-cpp11::writable::doubles
-jdatetime_floor_cpp(const cpp11::sexp x, const std::string& unit_name, const int n)
+// The compiled time zone of jdatetime `x`
+static
+const zone_table&
+tzone_table(const cpp11::sexp x)
 {
     const cpp11::strings tz_name_ =  cpp11::as_cpp<cpp11::strings>(x.attr("tzone"));
     std::string tz_name(tz_name_[0]);
-    const date::time_zone* tz{};
 
     if (!tz_name.size())
         tz_name = get_current_tzone_cpp();
 
-    if (!tzdb::locate_zone(tz_name, tz))
+    const zone_table* table{ locate_zone_table(tz_name) };
+    if (!table)
         cpp11::stop(std::string(tz_name + " not found in timezone database").c_str());
 
-    const auto opt{ string_to_unit(unit_name) };
-    if (!opt)
-        cpp11::stop("Invalid unit: (%s)", unit_name.c_str());
+    return *table;
+}
+
+// Applies `f` to the days of `x` and the round_kernel of `n` `unit_name`s
+template <class F>
+static
+cpp11::sexp
+map_jdate_rounded(const cpp11::sexp x, const std::string& unit_name, const int n, F f)
+{
+    return visit_round_kernel(round_unit(unit_name, true), n, [&](auto kernel) {
+        return map_jdate(x, [&](const date::local_days& ld) { return f(kernel, ld); });
+    });
+}
 
-    const auto unit{*opt};
+[[cpp11::register]]
+cpp11::sexp
+jdate_ceiling_cpp(const cpp11::sexp x, const std::string& unit_name, const int n)
+{
+    return map_jdate_rounded(x, unit_name, n, [](auto& kernel, const date::local_days& ld) {
+        return kernel.days(ld).ceiling;
+    });
+}
+
+[[cpp11::register]]
+cpp11::sexp
+jdate_floor_cpp(const cpp11::sexp x, const std::string& unit_name, const int n)
+{
+    return map_jdate_rounded(x, unit_name, n, [](auto& kernel, const date::local_days& ld) {
+        return kernel.floor(ld);
+    });
+}
+
+[[cpp11::register]]
+cpp11::sexp
+jdate_round_cpp(const cpp11::sexp x, const std::string& unit_name, const int n)
+{
+    return map_jdate_rounded(x, unit_name, n, [](auto& kernel, const date::local_days& ld) {
+        return nearest(ld, kernel.days(ld));
+    });
+}
+
+// Applies `f` to the seconds of `x` and a jdatetime_rounder for `n` `unit_name`s in the time
+// zone of `x`
+template <class F>
+static
+cpp11::writable::doubles
+map_jdatetime(const cpp11::sexp x, const std::string& unit_name, const int n, F f)
+{
+    const zone_table& table{ tzone_table(x) };
+    const Unit unit{ round_unit(unit_name, false) };
     const cpp11::doubles xx = cpp11::as_cpp<cpp11::doubles>(x);
     const R_xlen_t size = xx.size();
     cpp11::writable::doubles out(size);
-    date::sys_seconds ss;
+    const sys_info_cursor tz_cursor(table, REAL(xx), xx.size());
 
-    for (R_xlen_t i = 0; i < size; ++i)
-    {
-        if (std::isnan(xx[i]))
+    visit_round_kernel(unit, n, [&](const auto& kernel) {
+        jdatetime_rounder rounder(tz_cursor, kernel);
+        date::sys_seconds ss;
+
+        for (R_xlen_t i = 0; i < size; ++i)
         {
-            out[i] = NA_REAL;
-            continue;
+            if (std::isnan(xx[i]))
+            {
+                out[i] = NA_REAL;
+                continue;
+            }
+
+            ss = f(rounder, sys_seconds_from_double(xx[i]));
+            out[i] = static_cast<double>(ss.time_since_epoch().count());
         }
-
-        ss = floor_jdatetime(sys_seconds_from_double(xx[i]), tz, unit, n);
-        out[i] = static_cast<double>(ss.time_since_epoch().count());
-    }
+    });
 
     return out;
 }
 
+[[cpp11::register]]
+cpp11::writable::doubles
+jdatetime_floor_cpp(const cpp11::sexp x, const std::string& unit_name, const int n)
+{
+    return map_jdatetime(x, unit_name, n, [](auto& rounder, const sys_seconds& ss) {
+        return rounder.floor(ss);
+    });
+}
+
 [[cpp11::register]]
 cpp11::writable::doubles
 jdatetime_ceiling_cpp(const cpp11::sexp x, const std::string& unit_name, const int n)
 {
-    const cpp11::strings tz_name_ =  cpp11::as_cpp<cpp11::strings>(x.attr("tzone"));
-    std::string tz_name(tz_name_[0]);
-    const date::time_zone* tz{};
+    return map_jdatetime(x, unit_name, n, [](auto& rounder, const sys_seconds& ss) {
+        return rounder.ceiling(ss);
+    });
+}
 
-    if (!tz_name.size())
-        tz_name = get_current_tzone_cpp();
+[[cpp11::register]]
+cpp11::writable::doubles
+jdatetime_round_cpp(const cpp11::sexp x, const std::string& unit_name, const int n)
+{
+    return map_jdatetime(x, unit_name, n, [](auto& rounder, const sys_seconds& ss) {
+        return rounder.round(ss);
+    });
+}
 
-    if (!tzdb::locate_zone(tz_name, tz))
-        cpp11::stop(std::string(tz_name + " not found in timezone database").c_str());
+// The ids, 1-based, period starts and counts of `index` as a list, with the starts of type
+// `start_type`
+static
+cpp11::writable::list
+bucket_list(cpp11::writable::integers& id, const bucket_index& index, const SEXPTYPE start_type)
+{
+    const auto& starts = index.starts();
+    const R_xlen_t n_buckets = static_cast<R_xlen_t>(starts.size());
 
-    const auto opt{ string_to_unit(unit_name) };
-    if (!opt)
-        cpp11::stop("Invalid unit: (%s)", unit_name.c_str());
+    cpp11::sexp start{ Rf_allocVector(start_type, n_buckets) };
+    if (start_type == INTSXP)
+    {
+        std::transform(starts.cbegin(), starts.cend(), INTEGER(start),
+                       [](const double x) { return static_cast<int>(x); });
+    }
+    else
+    {
+        std::copy(starts.cbegin(), starts.cend(), REAL(start));
+    }
+
+    cpp11::writable::integers count(n_buckets);
+    std::copy(index.counts().cbegin(), index.counts().cend(), INTEGER(count));
+
+    cpp11::writable::list out({ id, start, count });
+    out.names() = {"id", "start", "count"};
+    return out;
+}
+
+[[cpp11::register]]
+cpp11::writable::list
+jdate_bucket_cpp(const cpp11::sexp x, const std::string& unit_name, const int n)
+{
+    const Unit unit{ round_unit(unit_name, true) };
+    const R_xlen_t size = Rf_xlength(x);
+    cpp11::writable::integers id(size);
+    int* pid = INTEGER(id);
+    bucket_index index;
+
+    visit_round_kernel(unit, n, [&](auto kernel) {
+        visit_days(x, [&](const auto* xx) {
+            for (R_xlen_t i = 0; i < size; ++i)
+            {
+                if (is_na_days(xx[i]))
+                {
+                    pid[i] = NA_INTEGER;
+                    continue;
+                }
+
+                const date::local_days ld{ date::days(static_cast<int>(xx[i])) };
+                const auto start = kernel.floor(ld).time_since_epoch().count();
+                pid[i] = index(static_cast<double>(start)) + 1;
+            }
+        });
+    });
 
-    const auto unit{*opt};
+    return bucket_list(id, index, TYPEOF(x) == INTSXP ? INTSXP : REALSXP);
+}
+
+[[cpp11::register]]
+cpp11::writable::list
+jdatetime_bucket_cpp(const cpp11::sexp x, const std::string& unit_name, const int n)
+{
+    const zone_table& table{ tzone_table(x) };
+    const Unit unit{ round_unit(unit_name, false) };
     const cpp11::doubles xx = cpp11::as_cpp<cpp11::doubles>(x);
     const R_xlen_t size = xx.size();
-    cpp11::writable::doubles out(size);
-    date::sys_seconds ss;
+    cpp11::writable::integers id(size);
+    int* pid = INTEGER(id);
+    const sys_info_cursor tz_cursor(table, REAL(xx), xx.size());
+    bucket_index index;
 
-    for (R_xlen_t i = 0; i < size; ++i)
-    {
-        if (std::isnan(xx[i]))
+    visit_round_kernel(unit, n, [&](const auto& kernel) {
+        jdatetime_rounder rounder(tz_cursor, kernel);
+
+        for (R_xlen_t i = 0; i < size; ++i)
         {
-            out[i] = NA_REAL;
-            continue;
+            if (std::isnan(xx[i]))
+            {
+                pid[i] = NA_INTEGER;
+                continue;
+            }
+
+            const sys_seconds start{ rounder.floor(sys_seconds_from_double(xx[i])) };
+            pid[i] = index(static_cast<double>(start.time_since_epoch().count())) + 1;
         }
+    });
 
-        ss = ceiling_jdatetime(sys_seconds_from_double(xx[i]), tz, unit, n);
-        out[i] = static_cast<double>(ss.time_since_epoch().count());
-    }
-
-    return out;
+    return bucket_list(id, index, REALSXP);
 }
 
 [[cpp11::register]]
@@ -1,57 +1,306 @@
+#include "shide.h"
+#include <shide/batch.h>
 #include <shide/seq.h>
 #include <shide/make.h>
+#include <shide/utils.h>
 #include <cpp11.hpp>
+#include <cmath>
+#include <cstdint>
+#include <optional>
 #include "R_ext/Print.h"
 
-[[cpp11::register]]
-cpp11::writable::doubles
-jdate_seq_by_month_cpp(const cpp11::sexp& x, const cpp11::integers& dm)
+namespace
 {
-    const cpp11::doubles xx = cpp11::as_cpp<cpp11::doubles>(x);
-    const R_xlen_t size = dm.size();
-    cpp11::writable::doubles out(size);
-    out[0] = xx[0];
+    double
+    seq_from(const cpp11::sexp& from)
+    {
+        const double out{ Rf_asReal(from) };
+        if (std::isnan(out))
+            cpp11::stop("`from` must not be `NA`.");
 
-    if (size == 1)
         return out;
+    }
+
+    double
+    seq_to(const cpp11::sexp& to)
+    {
+        const double out{ Rf_asReal(to) };
+        if (std::isnan(out))
+            cpp11::stop("`to` must not be `NA`.");
 
-    sh_year_month_day ymd{date::local_days{ date::days(static_cast<int>(xx[0])) } };
-    local_days ld;
+        return out;
+    }
 
-    for (R_xlen_t i = 1; i < size; ++i)
+    R_xlen_t
+    seq_length_out(const cpp11::sexp& length_out)
     {
-        ymd += date::months{ dm[i] - dm[i-1] };
+        return static_cast<R_xlen_t>(Rf_asReal(length_out));
+    }
+}
+
+// The days of a `jdate` or the seconds of a `jdatetime` from `from` by the whole number `by`, up
+// to `to` or `length_out` of them, as seq.int() gives them. Sequences of more than one element
+// are compact.
+[[cpp11::register]]
+cpp11::sexp
+seq_compact_cpp(const cpp11::sexp from, const cpp11::sexp to, const cpp11::sexp length_out,
+                const double by)
+{
+    const double from_{ seq_from(from) };
+    R_xlen_t size{};
 
-        if (ymd.ok())
-            ld = local_days(ymd);
+    if (to == R_NilValue)
+    {
+        size = seq_length_out(length_out);
+    }
+    else
+    {
+        const double to_{ seq_to(to) };
+        if (to_ == from_)
+        {
+            size = 1;
+        }
         else
-            ld = local_days(first_day_next_month(ymd));
+        {
+            if (by == 0)
+                cpp11::stop("`by` must not be zero.");
+
+            const double steps{ (to_ - from_) / by };
+            if (steps < 0)
+                cpp11::stop("Wrong sign in `by` argument.");
 
-        out[i] = make_jdate(ld);
+            size = static_cast<R_xlen_t>(std::floor(steps + 1e-10)) + 1;
+        }
     }
 
+    if (size > 1)
+        return new_arith_seq(from_, by, size);
+
+    cpp11::writable::doubles out(size);
+    if (size)
+        out[0] = from_;
+
     return out;
 }
 
+// The days of a `jdate` from `from` by `n` months or years, up to `to` or `length_out` of them.
+// Sequences of more than one element are compact.
 [[cpp11::register]]
-cpp11::writable::doubles
-jdate_seq_by_year_cpp(const cpp11::sexp& x, const cpp11::integers& dy)
+cpp11::sexp
+jdate_seq_by_cpp(const cpp11::sexp from, const cpp11::sexp to, const cpp11::sexp length_out,
+                 const std::string& unit_name, const int n)
 {
-    const cpp11::doubles xx = cpp11::as_cpp<cpp11::doubles>(x);
-    const R_xlen_t size = dy.size();
+    bool years{};
+    if (unit_name == "months")
+        years = false;
+    else if (unit_name == "years")
+        years = true;
+    else
+        cpp11::stop("Invalid unit: (%s)", unit_name.c_str());
+
+    const int from_{ static_cast<int>(seq_from(from)) };
+    const jdate_calendar_seq seq{ from_, n, years };
+    R_xlen_t size{};
+
+    if (to == R_NilValue)
+    {
+        size = seq_length_out(length_out);
+    }
+    else
+    {
+        const double to_{ seq_to(to) };
+        const std::int64_t steps{ seq.steps_to(
+            sh_year_month_day{ local_days{ date::days{ static_cast<int>(to_) } } }) };
+        if (n == 0 && steps != 0)
+            cpp11::stop("`by` must not be zero.");
+        if ((steps < 0 && n > 0) || (steps > 0 && n < 0))
+            cpp11::stop("Wrong sign in `by` argument.");
+
+        // the elements up to the month or year of `to`; the last one may still fall after it,
+        // or roll forward past it
+        size = static_cast<R_xlen_t>(n == 0 ? 1 : steps / n + 1);
+        while (size > 0)
+        {
+            const auto d = seq(size - 1);
+            if (d && (n > 0 ? *d <= to_ : *d >= to_))
+                break;
+
+            --size;
+        }
+    }
+
+    if (size > 1)
+        return new_calendar_seq(from_, n, years, size);
+
     cpp11::writable::doubles out(size);
-    out[0] = xx[0];
+    if (size)
+        out[0] = from_;
 
-    if (size == 1)
-        return out;
+    return out;
+}
+
+namespace
+{
+    enum class SeqUnit { months, years, dst_days };
+
+    // The elements of a sequence of date-times that step by `n` months, years or days of local
+    // time from `from`, keeping its time of day. An element is computed from its index with
+    // calendar arithmetic on the fields of `from` and resolved in the time zone through a
+    // local_info_cursor, so that consecutive elements rarely search the zone table. Invalid days
+    // roll forward to the first day of the next month and ambiguous times are resolved as `from`
+    // is, as jdatetime_update() does.
+    class jdatetime_seq_generator
+    {
+        SeqUnit unit_;
+        int n_;
+        sh_year_month_day ymd_;
+        local_days ld_;
+        std::chrono::seconds tod_;
+        choose choose_;
+        local_info_cursor cursor_;
+
+    public:
+        jdatetime_seq_generator(const sys_seconds& from, const zone_table& table,
+                                const SeqUnit unit, const int n)
+            : unit_{ unit }, n_{ n }, choose_{ sys_seconds_to_choose(from, table) },
+              cursor_{ table }
+        {
+            sys_info_cursor sys_cursor{ table };
+            const local_seconds ls{ to_local_seconds(from, sys_cursor) };
+            ld_ = date::floor<date::days>(ls);
+            ymd_ = sh_year_month_day{ ld_ };
+            tod_ = ls - ld_;
+        }
+
+        // the local time of element `k`, if it is within the calendar
+        std::optional<local_seconds> local(const R_xlen_t k) const
+        {
+            // far beyond the calendar in any unit; also keeps the steps within an int
+            constexpr long long max_steps{
+                366LL * (internal::UPPER_PERSIAN_YEAR - internal::LOWER_PERSIAN_YEAR + 1) };
+            const long long steps{ static_cast<long long>(k) * n_ };
+            if (steps > max_steps || steps < -max_steps)
+                return {};
+
+            if (unit_ == SeqUnit::dst_days)
+            {
+                const local_days ld{ ld_ + date::days{ static_cast<int>(steps) } };
+                if (!detail::days_ok(static_cast<int>(ld.time_since_epoch().count())))
+                    return {};
+
+                return local_seconds{ ld } + tod_;
+            }
+
+            sh_year_month_day ymd{ unit_ == SeqUnit::months ?
+                ymd_ + date::months{ static_cast<int>(steps) } :
+                ymd_ + date::years{ static_cast<int>(steps) } };
+            if (!ymd.ok())
+                ymd = first_day_next_month(ymd);
+            if (!ymd.ok())
+                return {};
+
+            return local_seconds{ local_days{ ymd } } + tod_;
+        }
+
+        // element `k` as seconds since the epoch, or NA if its local time doesn't exist
+        double operator()(const R_xlen_t k)
+        {
+            const auto ls = local(k);
+            return ls ? jdatetime_from_local_seconds(*ls, cursor_, choose_) : NA_REAL;
+        }
+
+        // whether element `k` comes after `to`, or before it for negative steps; an element
+        // that doesn't exist is compared by its local time and one beyond the calendar is past
+        // any `to`
+        bool past(const R_xlen_t k, const double to, const local_seconds& to_local)
+        {
+            const auto ls = local(k);
+            if (!ls)
+                return true;
+
+            const double x{ jdatetime_from_local_seconds(*ls, cursor_, choose_) };
+            if (!std::isnan(x))
+                return n_ > 0 ? x > to : x < to;
 
-    sh_year_month_day ymd{date::local_days{ date::days(static_cast<int>(xx[0])) } };
+            return n_ > 0 ? *ls > to_local : *ls < to_local;
+        }
 
-    for (R_xlen_t i = 1; i < size; ++i)
+        // the number of months, years or days between the dates of `from` and of the local time
+        // `to_local`
+        long long steps_to(const local_seconds& to_local) const
+        {
+            const local_days ld{ date::floor<date::days>(to_local) };
+            if (unit_ == SeqUnit::dst_days)
+                return (ld - ld_).count();
+
+            const sh_year_month_day ymd{ ld };
+            const long long years{ static_cast<int>(ymd.year()) - static_cast<int>(ymd_.year()) };
+            if (unit_ == SeqUnit::years)
+                return years;
+
+            return 12 * years + static_cast<long long>(static_cast<unsigned>(ymd.month())) -
+                static_cast<long long>(static_cast<unsigned>(ymd_.month()));
+        }
+    };
+}
+
+[[cpp11::register]]
+cpp11::writable::doubles
+jdatetime_seq_by_cpp(const cpp11::sexp from, const cpp11::sexp to, const cpp11::sexp length_out,
+                     const std::string& unit_name, const int n, const cpp11::strings& tzone)
+{
+    SeqUnit unit{};
+    if (unit_name == "months")
+        unit = SeqUnit::months;
+    else if (unit_name == "years")
+        unit = SeqUnit::years;
+    else if (unit_name == "DSTdays")
+        unit = SeqUnit::dst_days;
+    else
+        cpp11::stop("Invalid unit: (%s)", unit_name.c_str());
+
+    const std::string tz_name(tzone[0]);
+    const zone_table* table{ locate_zone_table(tz_name) };
+    if (!table)
+        cpp11::stop(std::string(tz_name + " not found in timezone database").c_str());
+
+    const double from_{ seq_from(from) };
+    jdatetime_seq_generator gen{ sys_seconds_from_double(from_), *table, unit, n };
+    R_xlen_t size{};
+
+    if (to == R_NilValue)
+    {
+        size = seq_length_out(length_out);
+    }
+    else
     {
-        ymd += date::years{ dy[i] - dy[i-1] };
-        out[i] = make_jdate(local_days(ymd));
+        const double to_{ seq_to(to) };
+        if (n == 0)
+            cpp11::stop("`by` must not be zero.");
+
+        sys_info_cursor sys_cursor{ *table };
+        const local_seconds to_local{ to_local_seconds(sys_seconds_from_double(to_), sys_cursor) };
+        const long long steps{ gen.steps_to(to_local) };
+        if ((steps < 0 && n > 0) || (steps > 0 && n < 0))
+        {
+            // as in seq.POSIXt(), which only rejects a wrong sign for months and years
+            if (unit != SeqUnit::dst_days)
+                cpp11::stop("Wrong sign in `by` argument.");
+        }
+        else
+        {
+            // the elements up to the period of `to`; the last few may still fall after `to` in
+            // it, as days roll forward into the next month or the time of day is later
+            size = static_cast<R_xlen_t>(steps / n + 1);
+            while (size > 0 && gen.past(size - 1, to_, to_local))
+                --size;
+        }
     }
 
+    cpp11::writable::doubles out(size);
+    double* p_out = REAL(out);
+    for (R_xlen_t k = 0; k < size; ++k)
+        p_out[k] = gen(k);
+
     return out;
 }
@@ -8,4 +8,28 @@
 
 date::sys_seconds sys_seconds_from_double(double x);
 
+// compact sequences, whose elements are computed when they are used (see compact.cpp)
+SEXP new_arith_seq(double from, double by, R_xlen_t size);
+SEXP new_calendar_seq(int from, int n, bool years, R_xlen_t size);
+
+inline bool is_na_days(const double x) { return std::isnan(x); }
+inline bool is_na_days(const int x) { return x == NA_INTEGER; }
+
+// Calls `f` with a pointer to the day counts of a `jdate`, which are stored either as doubles or,
+// for integer-backed `jdate`s, as integers
+template <class F>
+auto
+visit_days(const SEXP x, F f)
+{
+    switch (TYPEOF(x))
+    {
+    case INTSXP:
+        return f(INTEGER_RO(x));
+    case REALSXP:
+        return f(REAL_RO(x));
+    default:
+        cpp11::stop("`x` must be a double or integer vector.");
+    }
+}
+
 #endif
@@ -1,33 +1,36 @@
 #include "shide.h"
 #include <shide/utils.h>
 #include <shide/make.h>
+#include <cstdlib>
 
 [[cpp11::register]]
 cpp11::writable::doubles
-sys_seconds_from_local_days_cpp(const cpp11::doubles x, const cpp11::strings& tzone)
+sys_seconds_from_local_days_cpp(const cpp11::sexp x, const cpp11::strings& tzone)
 {
     const std::string tz_name(tzone[0]);
-    const date::time_zone* tz{};
 
-    if (!tzdb::locate_zone(tz_name, tz))
+    const zone_table* table{ locate_zone_table(tz_name) };
+    if (!table)
         cpp11::stop(std::string(tz_name + " not found in timezone database").c_str());
 
-    const R_xlen_t size = x.size();
+    const R_xlen_t size = Rf_xlength(x);
     cpp11::writable::doubles out(size);
     date::local_seconds ls;
-    date::local_info info;
     date::sys_seconds ss;
+    local_info_cursor cursor{ *table };
 
-    for (R_xlen_t i = 0; i < size; ++i) {
-        if (std::isnan(x[i])) {
-            out[i] = NA_REAL;
-            continue;
-        }
+    visit_days(x, [&](const auto* xx) {
+        for (R_xlen_t i = 0; i < size; ++i) {
+            if (is_na_days(xx[i])) {
+                out[i] = NA_REAL;
+                continue;
+            }
 
-        ls = date::local_seconds{ date::days{ static_cast<int>(x[i]) }};
-        ss = to_sys_seconds(ls, tz, info);
-        out[i] = static_cast<double>(ss.time_since_epoch().count());
-    }
+            ls = date::local_seconds{ date::days{ static_cast<int>(xx[i]) }};
+            ss = to_sys_seconds(ls, cursor);
+            out[i] = static_cast<double>(ss.time_since_epoch().count());
+        }
+    });
 
     return out;
 }
@@ -37,15 +40,15 @@ cpp11::writable::doubles
 local_days_from_sys_seconds_cpp(const cpp11::doubles x, const cpp11::strings& tzone)
 {
     const std::string tz_name(tzone[0]);
-    const date::time_zone* tz{};
 
-    if (!tzdb::locate_zone(tz_name, tz))
+    const zone_table* table{ locate_zone_table(tz_name) };
+    if (!table)
         cpp11::stop(std::string(tz_name + " not found in timezone database").c_str());
 
     const R_xlen_t size = x.size();
     cpp11::writable::doubles out(size);
     date::local_days ld{};
-    date::sys_info info;
+    sys_info_cursor tz_cursor(*table, REAL(x), x.size());
 
     for (R_xlen_t i = 0; i < size; ++i) {
         if (std::isnan(x[i])) {
@@ -53,18 +56,34 @@ local_days_from_sys_seconds_cpp(const cpp11::doubles x, const cpp11::strings& tz
             continue;
         }
 
-        ld = to_local_days(sys_seconds_from_double(x[i]), tz, info);
+        ld = to_local_days(sys_seconds_from_double(x[i]), tz_cursor);
         out[i] = make_jdate(ld);
     }
 
     return out;
 }
 
+// The local time zone is resolved through R, which may consult the system, only when the TZ
+// environment variable differs from what it was at the last resolution.
+[[cpp11::register]]
 std::string get_current_tzone_cpp() {
-    auto get_current_tzone = cpp11::package("shide")["get_current_tzone"];
-    cpp11::sexp result = get_current_tzone();
+    static bool resolved{ false };
+    static std::optional<std::string> tz_env{};
+    static std::string tz_name{};
+
+    const char* env = std::getenv("TZ");
+    const std::optional<std::string> current_env{
+        env ? std::optional<std::string>{ env } : std::nullopt };
+
+    if (resolved && current_env == tz_env)
+        return tz_name;
+
+    auto resolve_current_tzone = cpp11::package("shide")["resolve_current_tzone"];
+    cpp11::sexp result = resolve_current_tzone();
     cpp11::strings tz_name_ = cpp11::as_cpp<cpp11::strings>(result);
-    std::string tz_name(tz_name_[0]);
+    tz_name = std::string(tz_name_[0]);
+    tz_env = current_env;
+    resolved = true;
     return tz_name;
 }
 
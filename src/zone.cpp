@@ -1,12 +1,20 @@
 #include "shide.h"
+#include <shide/utils.h>
 
 std::string get_current_tzone_cpp();
 
+static
+SEXP
+abbrev_charsxp(const zone_table& table, const zone_interval& interval)
+{
+    const std::string& abbrev{ table.abbrev(interval) };
+    return Rf_mkCharLenCE(abbrev.c_str(), abbrev.size(), CE_UTF8);
+}
+
 [[cpp11::register]]
 cpp11::writable::list
 get_local_info_cpp(const cpp11::strings& x, const cpp11::strings& tzone)
 {
-    const date::time_zone* tz{};
     std::string tz_name(tzone[0]);
 
     if (!tz_name.size())
@@ -14,7 +22,8 @@ get_local_info_cpp(const cpp11::strings& x, const cpp11::strings& tzone)
         tz_name = get_current_tzone_cpp();
     }
 
-    if (!tzdb::locate_zone(tz_name, tz))
+    const zone_table* table{ locate_zone_table(tz_name) };
+    if (!table)
     {
         cpp11::stop(std::string(tz_name + " not found in timezone database").c_str());
     }
@@ -35,7 +44,7 @@ get_local_info_cpp(const cpp11::strings& x, const cpp11::strings& tzone)
     cpp11::writable::doubles second_dst(size);
     cpp11::writable::doubles second_offset(size);
     cpp11::writable::strings second_abbreviation(size);
-    date::local_info info;
+    zone_local_info info;
 
     for (R_xlen_t i = 0; i < size; ++i)
     {
@@ -51,7 +60,7 @@ get_local_info_cpp(const cpp11::strings& x, const cpp11::strings& tzone)
 
         auto ymd = sh_year_month_day{ fds.ymd };
         auto ls = date::local_days{ ymd } + fds.tod.to_duration();
-        tzdb::get_local_info(ls, tz, info);
+        info = table->local_info(ls);
 
         switch (info.result)
         {
@@ -60,7 +69,7 @@ get_local_info_cpp(const cpp11::strings& x, const cpp11::strings& tzone)
             second_dst[i] = static_cast<double>(info.second.save.count());
             second_offset[i] = static_cast<double>(info.second.offset.count());
             SET_STRING_ELT(second_abbreviation, i,
-                           Rf_mkCharLenCE(info.second.abbrev.c_str(), info.second.abbrev.size(), CE_UTF8));
+                           abbrev_charsxp(*table, info.second));
             break;
         case date::local_info::unique:
             res = "unique";
@@ -73,7 +82,7 @@ get_local_info_cpp(const cpp11::strings& x, const cpp11::strings& tzone)
             second_dst[i] = static_cast<double>(info.second.save.count());
             second_offset[i] = static_cast<double>(info.second.offset.count());
             SET_STRING_ELT(second_abbreviation, i,
-                           Rf_mkCharLenCE(info.second.abbrev.c_str(), info.second.abbrev.size(), CE_UTF8));
+                           abbrev_charsxp(*table, info.second));
             break;
         }
 
@@ -81,7 +90,7 @@ get_local_info_cpp(const cpp11::strings& x, const cpp11::strings& tzone)
         first_dst[i] = static_cast<double>(info.first.save.count());
         first_offset[i] = static_cast<double>(info.first.offset.count());
         SET_STRING_ELT(first_abbreviation, i,
-                       Rf_mkCharLenCE(info.first.abbrev.c_str(), info.first.abbrev.size(), CE_UTF8));
+                       abbrev_charsxp(*table, info.first));
     }
 
     cpp11::writable::list first{first_offset, first_dst, first_abbreviation};
@@ -106,14 +115,14 @@ get_sys_info_cpp(const cpp11::sexp x)
     const cpp11::doubles xx = cpp11::as_cpp<cpp11::doubles>(x);
     const cpp11::strings tz_name_ =  cpp11::as_cpp<cpp11::strings>(x.attr("tzone"));
     std::string tz_name(tz_name_[0]);
-    const date::time_zone* tz{};
 
     if (!tz_name.size())
     {
         tz_name = get_current_tzone_cpp();
     }
 
-    if (!tzdb::locate_zone(tz_name, tz))
+    const zone_table* table{ locate_zone_table(tz_name) };
+    if (!table)
     {
         cpp11::stop(std::string(tz_name + " not found in timezone database").c_str());
     }
@@ -122,7 +131,7 @@ get_sys_info_cpp(const cpp11::sexp x)
     cpp11::writable::doubles dst(size);
     cpp11::writable::doubles offset(size);
     cpp11::writable::strings abbreviation(size);
-    date::sys_info info;
+    sys_info_cursor tz_cursor(*table, REAL(xx), xx.size());
 
     for (R_xlen_t i = 0; i < size; ++i)
     {
@@ -134,10 +143,10 @@ get_sys_info_cpp(const cpp11::sexp x)
             continue;
         }
 
-        tzdb::get_sys_info(sys_seconds_from_double(xx[0]), tz, info);
+        const auto& info = tz_cursor(sys_seconds_from_double(xx[i]));
         dst[i] = static_cast<double>(info.save.count());
         offset[i] = static_cast<double>(info.offset.count());
-        SET_STRING_ELT(abbreviation, i, Rf_mkCharLenCE(info.abbrev.c_str(), info.abbrev.size(), CE_UTF8));
+        SET_STRING_ELT(abbreviation, i, abbrev_charsxp(*table, info));
     }
 
     cpp11::writable::list out({